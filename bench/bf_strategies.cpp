@@ -0,0 +1,112 @@
+// Compares the tsp::bf_strategy modes of tsp::seq_brute_force.
+//
+// Build and run with:
+//     meson compile -C builddir bench_bf_strategies && ./builddir/bench_bf_strategies
+//
+// The batched strategy scores with the kernel tsp::default_simd_isa picks for
+// this CPU, and the unrolled one only runs where there is one (p1).
+//
+// p3 is only run for the {0, 1, ...} slice (1/14 of its permutations) since
+// the full strategy would take minutes otherwise.
+//
+// Before timing anything every strategy is checked against held_karp on
+// random asymmetric runtime matrices (which skip none of the cycles the
+// symmetric ones can), whole and split by fix1, and any mismatch fails the run.
+#include "fmt/core.h"
+
+#include "tsp/data.hpp"
+#include "tsp/bf.hpp"
+#include "tsp/held_karp.hpp"
+
+#include <algorithm> // For std::min.
+#include <limits> // For std::numeric_limits.
+#include <optional>
+#include <random>
+#include <utility> // For std::pair.
+#include <chrono>
+#include <vector>
+
+namespace ch = std::chrono;
+using sc = ch::steady_clock;
+
+constexpr auto factorial(std::size_t n) -> double { return n <= 1 ? 1.0 : n * factorial(n - 1); }
+
+template<typename T, std::size_t Cells>
+auto bench(const char* name, const utils::bidimensional_access<T, Cells>& mat, std::optional<int> fix1)
+{
+    constexpr auto nodes = utils::ct_sqrt(Cells);
+    // Node 0 is always fixed, and fix1 fixes one more.
+    const auto permutations = factorial(nodes - 1 - !!fix1);
+
+    auto strategies = std::vector<std::pair<tsp::bf_strategy, const char*>>{
+        {tsp::bf_strategy::full,        "full"},
+        {tsp::bf_strategy::incremental, "incremental"},
+        {tsp::bf_strategy::batched,     "batched"},
+    };
+    // Otherwise it would be the full strategy again.
+    if constexpr(tsp::has_unrolled_v<utils::bidimensional_access<T, Cells>>) { strategies.push_back({tsp::bf_strategy::unrolled, "unrolled"}); }
+
+    for(auto [strategy, strategy_name] : strategies)
+    {
+        const auto start  = sc::now();
+        const auto answer = tsp::seq_brute_force(mat, fix1, strategy);
+        const auto end    = sc::now();
+        const auto ns     = ch::duration<double, std::nano>(end - start).count();
+        fmt::print(
+            "{}: {:<11} {:>10.3f}ms {:>8.3f}ns/permutation ({:.0f} permutations) cost = {}\n",
+            name, strategy_name, ns / 1e6, ns / permutations, permutations, std::get<0>(answer)
+        );
+    }
+}
+
+// How many strategy runs disagree with held_karp.
+auto check_asymmetric() -> std::size_t
+{
+    auto random = std::mt19937{1};
+    auto mismatches = std::size_t{0};
+    for(std::size_t nodes = 2; nodes <= 8; ++nodes)
+    {
+        for(auto round = 0; round < 20; ++round)
+        {
+            auto mat = utils::matrix<int>{nodes};
+            for(std::size_t x = 0; x < nodes; ++x) {
+                for(std::size_t y = 0; y < nodes; ++y) { mat[{x, y}] = x == y ? 0 : static_cast<int>(random() % 100); }
+            }
+            const auto optimum = std::get<0>(tsp::held_karp(mat));
+
+            const auto strategies = {
+                std::pair{tsp::bf_strategy::full, "full"}, std::pair{tsp::bf_strategy::incremental, "incremental"}, std::pair{tsp::bf_strategy::batched, "batched"},
+            };
+            for(const auto& [strategy, strategy_name] : strategies)
+            {
+                auto whole = std::get<0>(tsp::seq_brute_force(mat, {}, strategy));
+                auto split = whole;
+                if(nodes > 2)
+                {
+                    split = std::numeric_limits<std::size_t>::max();
+                    for(std::size_t fix1 = 1; fix1 < nodes; ++fix1) {
+                        split = std::min(split, std::get<0>(tsp::seq_brute_force(mat, static_cast<int>(fix1), strategy)));
+                    }
+                }
+                if(whole == optimum && split == optimum) continue;
+                ++mismatches;
+                fmt::print(
+                    "asymmetric check: {} nodes, {}: cost = {} (by fix1 {}) vs held_karp {}\n",
+                    nodes, strategy_name, whole, split, optimum
+                );
+            }
+        }
+    }
+    return mismatches;
+}
+
+int main()
+{
+    if(check_asymmetric()) return 1;
+    fmt::print("asymmetric check: ok\n");
+
+    fmt::print("batched kernel: {}\n", tsp::simd_isa_name(tsp::default_simd_isa()));
+    bench("p1",          tsp::data::p1, {});
+    bench("p3 (fix1=1)", tsp::data::p3, 1);
+    return 0;
+}
@@ -0,0 +1,276 @@
+// Times every solver on every instance with warmup and repetitions.
+//
+// Build and run with:
+//     meson compile -C builddir bench_solvers && ./builddir/bench_solvers [options]
+//
+// Options:
+//     --reps N           timed runs of each solver (default 5).
+//     --warmup N         untimed runs before those (default 1).
+//     --threads 1,2,4    thread counts for par_brute_force, one measurement each
+//                        (default: every hardware thread), always with the
+//                        threaded search, never the unrolled kernel.
+//     --pin              pin each worker to a core (and the sequential solvers
+//                        to the first one this process may use).
+//     --format F         table (default), csv or json.
+//     --filter S         only run the cases whose "instance:solver" name contains S.
+//     --heavy            also run the cases that take minutes (brute force on p3).
+//     --random 100,1000  sizes of the random instances (default 100,1000), 0 for none.
+//
+// For every case it reports the min, median and 95th percentile of the run
+// time, the cost and its gap to the known optimum, and for the brute force
+// ns/tour: the median time over the tours it enumerates ((n - 1)!, or half of
+// them on symmetric matrices, where every cycle is only tried one way), which
+// makes instances of different sizes comparable. It also reports the
+// Held-Karp lower bound of the instance (see one_tree.hpp) and the gap it
+// certifies, which doesn't need the optimum to be known.
+//
+// Besides p1..p5 it runs the construction heuristics (see construction.hpp)
+// on instances of uniformly random points, named rN for N nodes, always with
+// the same seed. Their optimum isn't known, so only the certified gap is
+// reported for them.
+#include "fmt/core.h"
+
+#include "tsp/data.hpp"
+#include "tsp/bf.hpp"
+#include "tsp/held_karp.hpp"
+#include "tsp/bnb.hpp"
+#include "tsp/approx.hpp"
+#include "tsp/construction.hpp"
+#include "tsp/lin_kernighan.hpp"
+#include "tsp/one_tree.hpp"
+#include "tsp/work_stealing.hpp"
+#include "tsp/instrument.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <cstring> // For strcmp.
+#include <cstdlib> // For strtoul.
+#include <chrono>
+#include <string>
+#include <vector>
+#include <random>
+#include <array>
+#include <cmath> // For std::ceil, std::hypot and std::lround.
+
+namespace ch = std::chrono;
+using sc = ch::steady_clock;
+
+struct config
+{
+    std::size_t reps   = 5;
+    std::size_t warmup = 1;
+    std::vector<std::size_t> threads{ tsp::default_workers() };
+    std::vector<std::size_t> random{ 100, 1000 };
+    bool pin   = false;
+    bool heavy = false;
+    std::string format = "table";
+    std::string filter;
+};
+
+struct record
+{
+    std::string instance;
+    std::string solver;
+    std::size_t nodes;
+    std::size_t threads;
+    double min_ns, median_ns, p95_ns;
+    std::optional<double> ns_per_tour;
+    std::size_t cost;
+    std::optional<std::size_t> optimum;
+    std::size_t bound;
+
+    auto gap() const -> std::optional<double>
+    {
+        if(!optimum) return std::nullopt;
+        return 100.0 * (static_cast<double>(cost) - *optimum) / *optimum;
+    }
+    auto certified_gap() const -> double { return 100.0 * tsp::gap_report{cost, bound}.gap(); }
+};
+
+constexpr auto factorial(std::size_t n) -> double { return n <= 1 ? 1.0 : n * factorial(n - 1); }
+
+// Tours the brute force enumerates on mat, see the top of the file.
+template<typename Mat>
+auto brute_force_tours(const Mat& mat) -> double
+{
+    const auto nodes = utils::nodes(mat);
+    if(nodes < 3) return 1;
+    return factorial(nodes - 1) / (utils::is_symmetric(mat) ? 2 : 1);
+}
+
+// Runs solve() cfg.warmup + cfg.reps times and fills in the timings and cost of r.
+// tours is the amount of tours solve() enumerates, for ns/tour.
+template<typename Solve>
+auto measure(const config& cfg, record r, std::optional<double> tours, Solve&& solve) -> record
+{
+    for(std::size_t i = 0; i < cfg.warmup; ++i) { r.cost = std::get<0>(solve()); tsp::instrument::take_reports(); }
+
+    auto samples = std::vector<double>{};
+    samples.reserve(cfg.reps);
+    for(std::size_t i = 0; i < cfg.reps; ++i)
+    {
+        const auto start  = sc::now();
+        const auto answer = solve();
+        const auto end    = sc::now();
+        samples.push_back(ch::duration<double, std::nano>(end - start).count());
+        r.cost = std::get<0>(answer);
+        // Only filled when built with instrumentation, the timings are what matters here.
+        tsp::instrument::take_reports();
+    }
+    std::sort(samples.begin(), samples.end());
+
+    const auto n = samples.size();
+    r.min_ns    = samples.front();
+    r.median_ns = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    r.p95_ns    = samples[static_cast<std::size_t>(std::ceil(0.95 * n)) - 1];
+    if(tours) r.ns_per_tour = r.median_ns / *tours;
+    return r;
+}
+
+// run(solver, tours, threads, solve) measures solve() as a case of the instance, unless filtered out.
+// tours is only given for the solvers that enumerate them (the brute force).
+template<typename Mat>
+auto make_runner(const config& cfg, const char* name, const Mat& mat, std::optional<std::size_t> optimum, std::size_t bound, std::vector<record>& out)
+{
+    return [&cfg, name, nodes = utils::nodes(mat), optimum, bound, &out](const char* solver, std::optional<double> tours, std::size_t threads, auto&& solve) {
+        if(!cfg.filter.empty() && (std::string{name} + ":" + solver).find(cfg.filter) == std::string::npos) return;
+        // Only single threaded cases pin this thread: the workers inherit its
+        // affinity, so pinning it would squeeze them all onto one core.
+        const auto pinned = tsp::pin_guard{cfg.pin && threads == 1 ? std::optional<std::size_t>{0} : std::nullopt};
+        out.push_back(measure(cfg, record{name, solver, nodes, threads, 0, 0, 0, {}, 0, optimum, bound}, tours, solve));
+    };
+}
+
+// The construction heuristics, space_filling_curve only when there are coordinates.
+template<typename Run, typename Mat>
+auto bench_heuristics(Run&& run, const Mat& mat, const std::vector<std::array<double, 2>>& coords)
+{
+    run("approx",             std::nullopt, 1, [&]{ return tsp::approx(mat); });
+    run("nearest_neighbor",   std::nullopt, 1, [&]{ return tsp::nearest_neighbor(mat); });
+    run("greedy_edge",        std::nullopt, 1, [&]{ return tsp::greedy_edge(mat); });
+    run("christofides",       std::nullopt, 1, [&]{ return tsp::christofides(mat); });
+    run("christofides_exact", std::nullopt, 1, [&]{ return tsp::christofides(mat, tsp::matching_method::exact); });
+    if(!coords.empty()) run("space_filling_curve", std::nullopt, 1, [&]{ return tsp::space_filling_curve(mat, coords); });
+    run("lin_kernighan",      std::nullopt, 1, [&]{ return tsp::lin_kernighan(mat); });
+}
+
+template<typename Mat>
+auto bench_instance(const config& cfg, const char* name, const Mat& mat, std::size_t optimum, bool small, std::vector<record>& out)
+{
+    const auto nodes = utils::nodes(mat);
+    const auto run = make_runner(cfg, name, mat, optimum, tsp::held_karp_bound(mat).bound, out);
+
+    bench_heuristics(run, mat, {});
+    if(nodes <= 22) run("held_karp", std::nullopt, 1, [&]{ return tsp::held_karp(mat); });
+    run("branch_and_bound", std::nullopt, 1, [&]{ return tsp::branch_and_bound(mat); });
+    if(small || cfg.heavy)
+    {
+        const auto tours = brute_force_tours(mat);
+        run("seq_brute_force", tours, 1, [&]{ return tsp::seq_brute_force(mat); });
+        for(const auto threads : cfg.threads) {
+            run("par_brute_force", tours, threads, [&]{ return tsp::par_brute_force(mat, threads, cfg.pin); });
+        }
+    }
+}
+
+// Uniformly random points in a 1000 x 1000 square, with rounded euclidean distances like TSPLIB's EUC_2D.
+auto bench_random(const config& cfg, std::size_t nodes, std::vector<record>& out)
+{
+    auto rng = std::mt19937_64{nodes};
+    auto coordinate = std::uniform_real_distribution<double>{0, 1000};
+    auto coords = std::vector<std::array<double, 2>>(nodes);
+    for(auto& c : coords) { c = {coordinate(rng), coordinate(rng)}; }
+
+    auto mat = utils::matrix<int>(nodes);
+    for(std::size_t y = 0; y < nodes; ++y) {
+        for(std::size_t x = 0; x < nodes; ++x) { mat[{x, y}] = static_cast<int>(std::lround(std::hypot(coords[x][0] - coords[y][0], coords[x][1] - coords[y][1]))); }
+    }
+
+    const auto name = fmt::format("r{}", nodes);
+    const auto run  = make_runner(cfg, name.c_str(), mat, std::nullopt, tsp::held_karp_bound(mat).bound, out);
+    bench_heuristics(run, mat, coords);
+}
+
+auto parse_list(const char* arg) -> std::vector<std::size_t>
+{
+    auto list = std::vector<std::size_t>{};
+    for(char* end = nullptr; *arg; arg = *end ? end + 1 : end) {
+        list.push_back(std::max<std::size_t>(1, std::strtoul(arg, &end, 10)));
+        if(end == arg) break;
+    }
+    return list;
+}
+
+auto print(const config& cfg, const std::vector<record>& records) -> void
+{
+    if(cfg.format == "csv")
+    {
+        fmt::print("instance,solver,nodes,threads,reps,min_ns,median_ns,p95_ns,ns_per_tour,cost,optimum,gap_percent,bound,certified_gap_percent\n");
+        for(const auto& r : records) {
+            fmt::print(
+                "{},{},{},{},{},{:.0f},{:.0f},{:.0f},{},{},{},{},{},{:.4f}\n",
+                r.instance, r.solver, r.nodes, r.threads, cfg.reps, r.min_ns, r.median_ns, r.p95_ns,
+                r.ns_per_tour ? fmt::format("{:.6g}", *r.ns_per_tour) : "", r.cost,
+                r.optimum ? fmt::format("{}", *r.optimum) : "", r.gap() ? fmt::format("{:.4f}", *r.gap()) : "",
+                r.bound, r.certified_gap()
+            );
+        }
+    }
+    else if(cfg.format == "json")
+    {
+        fmt::print("[\n");
+        for(std::size_t i = 0; i < records.size(); ++i) {
+            const auto& r = records[i];
+            fmt::print(
+                "  {{\"instance\": \"{}\", \"solver\": \"{}\", \"nodes\": {}, \"threads\": {}, \"reps\": {}, "
+                "\"min_ns\": {:.0f}, \"median_ns\": {:.0f}, \"p95_ns\": {:.0f}, \"ns_per_tour\": {}, "
+                "\"cost\": {}, \"optimum\": {}, \"gap_percent\": {}, "
+                "\"bound\": {}, \"certified_gap_percent\": {:.4f}}}{}\n",
+                r.instance, r.solver, r.nodes, r.threads, cfg.reps, r.min_ns, r.median_ns, r.p95_ns,
+                r.ns_per_tour ? fmt::format("{:.6g}", *r.ns_per_tour) : "null", r.cost,
+                r.optimum ? fmt::format("{}", *r.optimum) : "null", r.gap() ? fmt::format("{:.4f}", *r.gap()) : "null",
+                r.bound, r.certified_gap(), i + 1 < records.size() ? "," : ""
+            );
+        }
+        fmt::print("]\n");
+    }
+    else
+    {
+        fmt::print("{:<5} {:<19} {:>3} {:>12} {:>12} {:>12} {:>11} {:>8} {:>8} {:>8} {:>8}\n",
+            "inst", "solver", "thr", "min(us)", "median(us)", "p95(us)", "ns/tour", "cost", "gap(%)", "bound", "cert(%)");
+        for(const auto& r : records) {
+            fmt::print("{:<5} {:<19} {:>3} {:>12.1f} {:>12.1f} {:>12.1f} {:>11} {:>8} {:>8} {:>8} {:>8.3f}\n",
+                r.instance, r.solver, r.threads, r.min_ns / 1e3, r.median_ns / 1e3, r.p95_ns / 1e3,
+                r.ns_per_tour ? fmt::format("{:.4g}", *r.ns_per_tour) : "-", r.cost,
+                r.gap() ? fmt::format("{:.3f}", *r.gap()) : "-", r.bound, r.certified_gap());
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    auto cfg = config{};
+    for(auto arg = 1; arg < argc; ++arg)
+    {
+        const auto has_value = arg + 1 < argc;
+        if     (strcmp(argv[arg], "--reps") == 0 && has_value)    { cfg.reps = std::max<std::size_t>(1, std::strtoul(argv[++arg], nullptr, 10)); }
+        else if(strcmp(argv[arg], "--warmup") == 0 && has_value)  { cfg.warmup = std::strtoul(argv[++arg], nullptr, 10); }
+        else if(strcmp(argv[arg], "--threads") == 0 && has_value) { cfg.threads = parse_list(argv[++arg]); }
+        else if(strcmp(argv[arg], "--format") == 0 && has_value)  { cfg.format = argv[++arg]; }
+        else if(strcmp(argv[arg], "--filter") == 0 && has_value)  { cfg.filter = argv[++arg]; }
+        else if(strcmp(argv[arg], "--random") == 0 && has_value)  { cfg.random = parse_list(argv[++arg]); std::erase_if(cfg.random, [](std::size_t n) { return n < 3; }); }
+        else if(strcmp(argv[arg], "--pin") == 0)   { cfg.pin = true; }
+        else if(strcmp(argv[arg], "--heavy") == 0) { cfg.heavy = true; }
+        else { fmt::print(stderr, "unknown argument: {}\n", argv[arg]); return 1; }
+    }
+
+    auto records = std::vector<record>{};
+    bench_instance(cfg, "p1", tsp::data::p1, tsp::data::p1_answer, true,  records);
+    bench_instance(cfg, "p2", tsp::data::p2, tsp::data::p2_answer, true,  records);
+    bench_instance(cfg, "p3", tsp::data::p3, tsp::data::p3_answer, false, records);
+    bench_instance(cfg, "p4", tsp::data::p4, tsp::data::p4_answer, false, records);
+    bench_instance(cfg, "p5", tsp::data::p5, tsp::data::p5_answer, false, records);
+    for(const auto nodes : cfg.random) { bench_random(cfg, nodes, records); }
+    print(cfg, records);
+    return 0;
+}
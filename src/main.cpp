@@ -3,19 +3,56 @@
 
 #include "tsp/data.hpp"
 #include "tsp/bf.hpp"
+#include "tsp/held_karp.hpp"
+#include "tsp/bnb.hpp"
 #include "tsp/approx.hpp"
+#include "tsp/construction.hpp"
+#include "tsp/tsplib.hpp"
+#include "tsp/local_search.hpp"
+#include "tsp/lin_kernighan.hpp"
+#include "tsp/one_tree.hpp"
+#include "tsp/instrument.hpp"
+#include "tsp/batch.hpp"
+#include "tsp/cache.hpp"
 
 #include <chrono>
+#include <optional>
 #include <cstring> // For strcmp.
+#include <cstdlib> // For strtol.
+#include <string>
 
 namespace ch = std::chrono;
-using sc = ch::system_clock;
+using sc = ch::steady_clock;
 using us = ch::microseconds;
 using ms = ch::milliseconds;
 using s  = ch::seconds;
 template< typename T, typename U>
 constexpr auto to(U&& t) { return ch::duration_cast<T>(t).count(); }
 
+// Prints (and clears) what the solvers that just ran counted, when built with instrumentation.
+auto print_instrumentation(const std::string& problem) -> void
+{
+    for(const auto& report : tsp::instrument::take_reports())
+    {
+        auto line = fmt::format("{}:     {}: wall {}us", problem, report.solver, to<us>(report.wall));
+        for(std::size_t c = 0; c < tsp::instrument::counter_count; ++c) {
+            const auto total = report.total(static_cast<tsp::instrument::counter>(c));
+            if(total) line += fmt::format(", {} {}", tsp::instrument::counter_names[c], total);
+        }
+        fmt::print("{}\n", line);
+
+        if(report.workers.size() < 2) continue;
+        for(std::size_t w = 0; w < report.workers.size(); ++w) {
+            const auto& counts = report.workers[w].counts;
+            fmt::print(
+                "{}:       worker {}: busy {}us, expanded {}, permutations {}, prunes {}\n",
+                problem, w, to<us>(report.workers[w].busy), counts[tsp::instrument::expanded],
+                counts[tsp::instrument::permutations], counts[tsp::instrument::prunes]
+            );
+        }
+    }
+}
+
 int main(int argc, char* argv[])
 {
     // Defaults
@@ -37,12 +74,54 @@ int main(int argc, char* argv[])
     auto p4_approx = true;
     auto p5_approx = true;
 
+    auto p1_hk = true;
+    auto p2_hk = true;
+    auto p3_hk = true;
+    auto p4_hk = true;
+    auto p5_hk = false; // Would need tens of gigabytes of memory.
+
+    auto p1_bnb = true;
+    auto p2_bnb = true;
+    auto p3_bnb = true;
+    auto p4_bnb = true;
+    auto p5_bnb = true;
+
+    auto p1_lk = true;
+    auto p2_lk = true;
+    auto p3_lk = true;
+    auto p4_lk = true;
+    auto p5_lk = true;
+
+    // Runs 2-opt/Or-opt over the tour of every solver and reports it on its own line.
+    auto local_search = false;
+    // Solves p1..p5 all at once with tsp::batch_solver instead of one solver at a time.
+    auto batch = false;
+    // Runs every brute force (even on p4 and p5) with this many milliseconds
+    // each, printing the best tour found in that time and how far it got.
+    auto budget_ms = std::optional<long>{};
+
     #define CHECK_ARG(argstr, argname, enableflag, disableflag)     \
         if     ( strcmp(argstr, enableflag) == 0)  { argname = 1; } \
         else if( strcmp(argstr, disableflag) == 0) { argname = 0; }
 
+    // When given, only this instance is solved instead of p1..p5.
+    const char* tsplib_path   = nullptr;
+    const char* opt_tour_path = nullptr;
+    // With --batch, keeps the tours found in this file and answers from it the next time.
+    const char* cache_path    = nullptr;
+    // With --tsplib, solves coordinate instances without building their matrix
+    // (only the heuristics, for instances too big for a dense one).
+    auto compact = false;
+
     for(auto arg = 1; arg < argc; ++arg)
     {
+        if(strcmp(argv[arg], "--tsplib") == 0 && arg + 1 < argc)   { tsplib_path   = argv[++arg]; continue; }
+        if(strcmp(argv[arg], "--opt-tour") == 0 && arg + 1 < argc) { opt_tour_path = argv[++arg]; continue; }
+        if(strcmp(argv[arg], "--cache") == 0 && arg + 1 < argc)    { cache_path    = argv[++arg]; continue; }
+        if(strcmp(argv[arg], "--budget-ms") == 0 && arg + 1 < argc) { budget_ms = std::strtol(argv[++arg], nullptr, 10); continue; }
+        CHECK_ARG(argv[arg], local_search, "--local-search", "--no-local-search");
+        CHECK_ARG(argv[arg], batch, "--batch", "--no-batch");
+        CHECK_ARG(argv[arg], compact, "--compact", "--no-compact");
         CHECK_ARG(argv[arg], p1_bf_st, "--p1:seq-brute-force", "--p1:no-seq-brute-force");
         CHECK_ARG(argv[arg], p2_bf_st, "--p2:seq-brute-force", "--p2:no-seq-brute-force");
         CHECK_ARG(argv[arg], p3_bf_st, "--p3:seq-brute-force", "--p3:no-seq-brute-force");
@@ -58,6 +137,156 @@ int main(int argc, char* argv[])
         CHECK_ARG(argv[arg], p3_approx, "--p3:approx", "--p3:no-approx");
         CHECK_ARG(argv[arg], p4_approx, "--p4:approx", "--p4:no-approx");
         CHECK_ARG(argv[arg], p5_approx, "--p5:approx", "--p5:no-approx");
+        CHECK_ARG(argv[arg], p1_hk, "--p1:held-karp", "--p1:no-held-karp");
+        CHECK_ARG(argv[arg], p2_hk, "--p2:held-karp", "--p2:no-held-karp");
+        CHECK_ARG(argv[arg], p3_hk, "--p3:held-karp", "--p3:no-held-karp");
+        CHECK_ARG(argv[arg], p4_hk, "--p4:held-karp", "--p4:no-held-karp");
+        CHECK_ARG(argv[arg], p5_hk, "--p5:held-karp", "--p5:no-held-karp");
+        CHECK_ARG(argv[arg], p1_bnb, "--p1:branch-and-bound", "--p1:no-branch-and-bound");
+        CHECK_ARG(argv[arg], p2_bnb, "--p2:branch-and-bound", "--p2:no-branch-and-bound");
+        CHECK_ARG(argv[arg], p3_bnb, "--p3:branch-and-bound", "--p3:no-branch-and-bound");
+        CHECK_ARG(argv[arg], p4_bnb, "--p4:branch-and-bound", "--p4:no-branch-and-bound");
+        CHECK_ARG(argv[arg], p5_bnb, "--p5:branch-and-bound", "--p5:no-branch-and-bound");
+        CHECK_ARG(argv[arg], p1_lk, "--p1:lin-kernighan", "--p1:no-lin-kernighan");
+        CHECK_ARG(argv[arg], p2_lk, "--p2:lin-kernighan", "--p2:no-lin-kernighan");
+        CHECK_ARG(argv[arg], p3_lk, "--p3:lin-kernighan", "--p3:no-lin-kernighan");
+        CHECK_ARG(argv[arg], p4_lk, "--p4:lin-kernighan", "--p4:no-lin-kernighan");
+        CHECK_ARG(argv[arg], p5_lk, "--p5:lin-kernighan", "--p5:no-lin-kernighan");
+    }
+
+    if(tsplib_path)
+    {
+        auto start = sc::now();
+        const auto instance = tsp::tsplib::load(tsplib_path, {.matrix = !compact});
+        auto end = sc::now();
+
+        if(instance.weights != tsp::tsplib::metric::explicit_weights && compact)
+        {
+            const auto mat = tsp::tsplib::coordinates(instance);
+            fmt::print("{}: loaded {} nodes (no matrix) in {}us\n", instance.name, utils::nodes(mat), to<us>(end - start));
+
+            auto answer = std::string{"?"};
+            if(opt_tour_path) { answer = std::to_string(tsp::tsplib::cost(mat, tsp::tsplib::load_tour(opt_tour_path))); }
+
+            // No bound here, it looks at every edge many times over.
+            const auto time = [&](const char* method, auto&& solve) {
+                const auto start  = sc::now();
+                const auto result = solve(mat);
+                const auto end    = sc::now();
+                fmt::print(
+                    "{}: tsp::{}: {}us cost(answer vs min) = {} vs {}\n",
+                    instance.name, method, to<us>(end - start), std::get<0>(result), answer
+                );
+                print_instrumentation(instance.name);
+                if(local_search) {
+                    const auto [improved, report] = tsp::local_search(mat, result);
+                    fmt::print(
+                        "{}: tsp::{} + tsp::local_search: {}us cost(answer vs min) = {} vs {} ({} -> {}, {} 2-opt and {} or-opt moves)\n",
+                        instance.name, method, to<us>(report.time), std::get<0>(improved), answer,
+                        report.cost_before, report.cost_after, report.two_opt_moves, report.or_opt_moves
+                    );
+                }
+            };
+
+            time("approx", [](const auto& mat){ return tsp::approx(mat); });
+            time("nearest_neighbor", [](const auto& mat){ return tsp::nearest_neighbor(mat); });
+            time("greedy_edge", [](const auto& mat){ return tsp::greedy_edge(mat); });
+            // Not the exact matching, it keeps all the edges between the odd nodes.
+            time("christofides", [](const auto& mat){ return tsp::christofides(mat, tsp::matching_method::greedy); });
+            time("space_filling_curve", [&](const auto& mat){ return tsp::space_filling_curve(mat, instance.coords); });
+            time("lin_kernighan", [](const auto& mat){ return tsp::lin_kernighan(mat); });
+            return 0;
+        }
+        fmt::print("{}: loaded {} nodes in {}us\n", instance.name, utils::nodes(instance.mat), to<us>(end - start));
+
+        // The cost of the known optimal tour plays the role of pN_answer.
+        auto answer = std::string{"?"};
+        if(opt_tour_path) { answer = std::to_string(tsp::tsplib::cost(instance.mat, tsp::tsplib::load_tour(opt_tour_path))); }
+
+        // The lines are printed once every solver ran, so the Held-Karp bound
+        // (which only depends on the instance) is computed a single time with
+        // the best tour found as its upper bound.
+        struct timed_result { const char* method; long long time; tsp::result<decltype(instance.mat)> result; };
+        auto results = std::vector<timed_result>{};
+        const auto time = [&](const char* method, auto&& solve) {
+            const auto start  = sc::now();
+            auto result       = solve(instance.mat);
+            const auto end    = sc::now();
+            print_instrumentation(instance.name);
+            if(local_search) {
+                const auto [improved, report] = tsp::local_search(instance.mat, result);
+                fmt::print(
+                    "{}: tsp::{} + tsp::local_search: {}us cost(answer vs min) = {} vs {} ({} -> {}, {} 2-opt and {} or-opt moves), cicle = {}\n",
+                    instance.name, method, to<us>(report.time), std::get<0>(improved), answer,
+                    report.cost_before, report.cost_after, report.two_opt_moves, report.or_opt_moves, std::get<1>(improved)
+                );
+            }
+            results.push_back({method, to<us>(end - start), std::move(result)});
+        };
+
+        time("approx", [](const auto& mat){ return tsp::approx(mat); });
+        time("nearest_neighbor", [](const auto& mat){ return tsp::nearest_neighbor(mat); });
+        time("greedy_edge", [](const auto& mat){ return tsp::greedy_edge(mat); });
+        time("christofides", [](const auto& mat){ return tsp::christofides(mat); });
+        time("christofides (exact matching)", [](const auto& mat){ return tsp::christofides(mat, tsp::matching_method::exact); });
+        if(!instance.coords.empty()) {
+            time("space_filling_curve", [&](const auto& mat){ return tsp::space_filling_curve(mat, instance.coords); });
+        }
+        time("lin_kernighan", [](const auto& mat){ return tsp::lin_kernighan(mat); });
+        if(utils::nodes(instance.mat) <= 64) {
+            time("branch_and_bound", [](const auto& mat){ return tsp::branch_and_bound(mat); });
+        } else {
+            fmt::print("{}: tsp::branch_and_bound: SKIPPED\n", instance.name);
+        }
+
+        // Without a known optimum the Held-Karp bound tells how good each tour is.
+        auto upper_bound = std::get<0>(results.front().result);
+        for(const auto& r : results) { upper_bound = std::min(upper_bound, std::get<0>(r.result)); }
+        start = sc::now();
+        const auto bound = tsp::held_karp_bound(instance.mat, upper_bound).bound;
+        end = sc::now();
+        fmt::print("{}: tsp::held_karp_bound: {}us bound = {}\n", instance.name, to<us>(end - start), bound);
+        for(const auto& [method, time, result] : results)
+        {
+            const auto report = tsp::gap_report{std::get<0>(result), bound};
+            fmt::print(
+                "{}: tsp::{}: {}us cost(answer vs min) = {} vs {}, bound = {} (gap <= {:.4f}%), cicle = {}\n",
+                instance.name, method, time, std::get<0>(result), answer,
+                report.bound, 100 * report.gap(), std::get<1>(result)
+            );
+        }
+        return 0;
+    }
+
+    if(batch)
+    {
+        using runtime_matrix = utils::matrix<int>;
+        const auto names     = std::array{"p1", "p2", "p3", "p4", "p5"};
+        const auto answers   = std::array<std::size_t, 5>{tsp::data::p1_answer, tsp::data::p2_answer, tsp::data::p3_answer, tsp::data::p4_answer, tsp::data::p5_answer};
+        const auto instances = std::vector<runtime_matrix>{
+            runtime_matrix{tsp::data::p1}, runtime_matrix{tsp::data::p2}, runtime_matrix{tsp::data::p3},
+            runtime_matrix{tsp::data::p4}, runtime_matrix{tsp::data::p5},
+        };
+
+        auto cache = std::optional<tsp::solution_cache>{};
+        if(cache_path) cache.emplace(tsp::cache_options{.path = cache_path});
+
+        auto solver = tsp::batch_solver<runtime_matrix>{{.cache = cache ? &*cache : nullptr}};
+        auto start = sc::now();
+        solver.solve(instances, [&](tsp::batch_result<runtime_matrix>&& r) {
+            fmt::print(
+                "{}: tsp::batch ({}, worker {}): {}us cost(answer vs min) = {} vs {}, cicle = {}\n",
+                names[r.index], r.strategy == tsp::batch_strategy::exact ? "exact" : "approx", r.worker,
+                to<us>(r.time), std::get<0>(r.solution), answers[r.index], std::get<1>(r.solution)
+            );
+        });
+        auto end = sc::now();
+        fmt::print("tsp::batch: {} instances on {} threads in {}us\n", instances.size(), solver.threads(), to<us>(end - start));
+        if(cache) {
+            const auto stats = cache->stats();
+            fmt::print("tsp::solution_cache: {} hits, {} warm starts, {} misses\n", stats.hits, stats.warm_starts, stats.misses);
+        }
+        return 0;
     }
 
     #define TIME_IF_SET(varname, problem, method, timeunit)                                                  \
@@ -72,6 +301,19 @@ int main(int argc, char* argv[])
                 tsp::data::problem##_answer,                                                                 \
                 std::get<1>(answer)                                                                          \
             );                                                                                               \
+            print_instrumentation(#problem);                                                                 \
+            if(local_search) {                                                                               \
+                const auto [improved, report] = tsp::local_search(tsp::data::problem, answer);               \
+                fmt::print(                                                                                  \
+                    #problem ": tsp::" #method " + tsp::local_search: {}us cost(answer vs min) = {} vs {} "  \
+                    "({} -> {}, {} 2-opt and {} or-opt moves), cicle = {}\n",                                \
+                    to<us>(report.time),                                                                     \
+                    std::get<0>(improved),                                                                   \
+                    tsp::data::problem##_answer,                                                             \
+                    report.cost_before, report.cost_after, report.two_opt_moves, report.or_opt_moves,        \
+                    std::get<1>(improved)                                                                    \
+                );                                                                                           \
+            }                                                                                                \
         } else {fmt::print( #problem ": tsp::" #method ": SKIPPED\n");}
 
     TIME_IF_SET(p1_approx, p1, approx, us);
@@ -80,6 +322,60 @@ int main(int argc, char* argv[])
     TIME_IF_SET(p4_approx, p4, approx, us);
     TIME_IF_SET(p5_approx, p5, approx, us);
 
+    TIME_IF_SET(p1_lk, p1, lin_kernighan, us);
+    TIME_IF_SET(p2_lk, p2, lin_kernighan, us);
+    TIME_IF_SET(p3_lk, p3, lin_kernighan, us);
+    TIME_IF_SET(p4_lk, p4, lin_kernighan, us);
+    TIME_IF_SET(p5_lk, p5, lin_kernighan, us);
+
+    TIME_IF_SET(p1_hk, p1, held_karp, us);
+    TIME_IF_SET(p2_hk, p2, held_karp, us);
+    TIME_IF_SET(p3_hk, p3, held_karp, ms);
+    TIME_IF_SET(p4_hk, p4, held_karp, ms);
+    TIME_IF_SET(p5_hk, p5, held_karp, s);
+
+    TIME_IF_SET(p1_bnb, p1, branch_and_bound, us);
+    TIME_IF_SET(p2_bnb, p2, branch_and_bound, us);
+    TIME_IF_SET(p3_bnb, p3, branch_and_bound, us);
+    TIME_IF_SET(p4_bnb, p4, branch_and_bound, us);
+    TIME_IF_SET(p5_bnb, p5, branch_and_bound, us);
+
+    #define TIME_WITH_BUDGET(problem, method)                                                                 \
+        {                                                                                                     \
+            auto limits = tsp::budget::within(ms{*budget_ms});                                                \
+            limits.report_every = s{1};                                                                       \
+            limits.on_progress  = [](const tsp::progress& p) {                                                \
+                fmt::print(#problem ":     best so far {}, {:.4f}% covered\n", p.incumbent, 100 * p.covered); \
+            };                                                                                                \
+            auto start  = sc::now();                                                                          \
+            auto answer = tsp::method(tsp::data::problem, limits);                                            \
+            auto end    = sc::now();                                                                          \
+            auto report = tsp::certify(tsp::data::problem, answer.cost);                                      \
+            fmt::print(                                                                                       \
+                #problem ": tsp::" #method " ({}ms budget): {}ms cost(answer vs min) = {} vs {}, "            \
+                "optimal = {}, covered = {:.4f}%, bound = {} (gap <= {:.4f}%), cicle = {}\n",                 \
+                *budget_ms, to<ms>(end - start), answer.cost, tsp::data::problem##_answer,                     \
+                answer.optimal, 100 * answer.covered, report.bound, 100 * report.gap(), answer.tour            \
+            );                                                                                                \
+            print_instrumentation(#problem);                                                                  \
+        }
+
+    if(budget_ms)
+    {
+        TIME_WITH_BUDGET(p1, par_brute_force);
+        TIME_WITH_BUDGET(p2, par_brute_force);
+        TIME_WITH_BUDGET(p3, par_brute_force);
+        TIME_WITH_BUDGET(p4, par_brute_force);
+        TIME_WITH_BUDGET(p5, par_brute_force);
+
+        TIME_WITH_BUDGET(p1, seq_brute_force);
+        TIME_WITH_BUDGET(p2, seq_brute_force);
+        TIME_WITH_BUDGET(p3, seq_brute_force);
+        TIME_WITH_BUDGET(p4, seq_brute_force);
+        TIME_WITH_BUDGET(p5, seq_brute_force);
+        return 0;
+    }
+
     TIME_IF_SET(p1_bf_mt, p1, par_brute_force, ms);
     TIME_IF_SET(p2_bf_mt, p2, par_brute_force, us);
     TIME_IF_SET(p3_bf_mt, p3, par_brute_force, s);
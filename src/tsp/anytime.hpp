@@ -0,0 +1,128 @@
+/// Contains what the solvers need to be stopped early and report progress.
+//
+// The exact solvers can take far longer than anyone is willing to wait, so
+// they have overloads taking a budget: a deadline, a cancel_token (or both)
+// and an optional progress callback. They start from a heuristic tour, so
+// there is always an answer, and when the budget runs out they return the
+// best tour found so far:
+//
+//     auto token  = tsp::cancel_token{};
+//     auto limits = tsp::budget::within(std::chrono::seconds{10});
+//     limits.token = &token;
+//     limits.on_progress = [](const tsp::progress& p){ ... };
+//     const auto [cost, tour, optimal, covered] = tsp::seq_brute_force(mat, limits);
+//
+// optimal is only true when the search went through everything, and covered
+// is the fraction of the search space that was searched or pruned away.
+//
+// The callback runs on (one of) the solver's threads, about every
+// report_every, with the best cost so far and the fraction covered.
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <cstddef> // For std::size_t.
+#include <atomic>
+#include <chrono>
+
+#include "tsp/result.hpp"
+
+namespace tsp
+{
+    // Lets another thread ask a running solver to stop.
+    class cancel_token
+    {
+    public:
+        auto cancel() -> void { flag.store(true, std::memory_order_relaxed); }
+        auto cancelled() const -> bool { return flag.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<bool> flag{false};
+    };
+
+    struct progress
+    {
+        std::size_t incumbent; // Cost of the best tour so far.
+        double covered;        // Fraction of the search space done, from 0 to 1.
+    };
+
+    // When a solver has to stop, and who to tell how it is going. The default one never runs out.
+    struct budget
+    {
+        std::optional<std::chrono::steady_clock::time_point> deadline;
+        const cancel_token* token = nullptr;
+        std::function<void(const progress&)> on_progress;
+        std::chrono::milliseconds report_every{100};
+
+        static auto within(std::chrono::steady_clock::duration time) -> budget
+        {
+            auto b = budget{};
+            b.deadline = std::chrono::steady_clock::now() + time;
+            return b;
+        }
+
+        auto expired(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const -> bool
+        {
+            return (token && token->cancelled()) || (deadline && now >= *deadline);
+        }
+    };
+
+    template<typename Mat>
+    struct anytime_result
+    {
+        std::size_t cost;
+        cicle<Mat> tour;
+        bool optimal;   // The search finished, cost is the optimum.
+        double covered; // 1 when optimal.
+    };
+}
+
+namespace tsp::detail
+{
+    // Solvers call tick() from their loops, but the clock (and the token) are
+    // only looked at once every `every` calls, so it costs next to nothing.
+    // Once it says stop it keeps saying so.
+    class budget_checker
+    {
+    public:
+        budget_checker(const budget& limits, std::size_t every, bool reports = true)
+            : limits{limits}
+            , every{every}
+            , reports{reports && limits.on_progress}
+            , next_report{std::chrono::steady_clock::now() + limits.report_every}
+        {}
+
+        // covered() is only called when a report is due.
+        template<typename Covered>
+        auto tick(std::size_t incumbent, Covered&& covered) -> bool
+        {
+            if(stop) return true;
+            if(++calls < every) return false;
+            calls = 0;
+
+            const auto now = std::chrono::steady_clock::now();
+            stop = limits.expired(now);
+            if(reports && now >= next_report) {
+                limits.on_progress(progress{incumbent, covered()});
+                next_report = now + limits.report_every;
+            }
+            return stop;
+        }
+
+        auto stopped() const -> bool { return stop; }
+
+        // The last report, when the solver is done.
+        auto finish(std::size_t incumbent, double covered) const -> void
+        {
+            if(reports) limits.on_progress(progress{incumbent, covered});
+        }
+
+    private:
+        const budget& limits;
+        std::size_t every;
+        std::size_t calls = 0;
+        bool reports;
+        bool stop = false;
+        std::chrono::steady_clock::time_point next_report;
+    };
+}
@@ -4,91 +4,191 @@
 
 #include <algorithm>
 #include <numeric>
+#include <limits> // For std::numeric_limits.
+#include <vector>
+#include <queue>
+#include <tuple>
 #include <array>
-#include <set>
 
 #include "utils.hpp"
+#include "tsp/graph.hpp"
+#include "tsp/result.hpp"
+#include "tsp/instrument.hpp"
 
 namespace tsp
 {
-    // Forward decls.
-    template<typename T, std::size_t Cells>
-    inline auto prims(const utils::bidimensional_access<T, Cells>& mat) -> std::array<T, Cells>;
-    template<typename T, std::size_t Cells, typename It>
-    inline auto tour_mst(const utils::bidimensional_access<T, Cells>& mst, It&& visited_it, std::size_t node = 0) -> void;
-
-    template<typename T, std::size_t Cells>
-    inline auto approx(
-        const utils::bidimensional_access<T, Cells>& mat
-    ) -> std::tuple< std::size_t, std::array<std::size_t, utils::ct_sqrt(Cells) + 1> >
-    {
-        constexpr auto nodes = utils::ct_sqrt(Cells);
+    // The MST as a parent array: parent[v] is the node v was reached from, and
+    // the root (node 0) is its own parent.
+    template<typename Mat>
+    using mst_parents = utils::node_array<std::size_t, Mat>;
 
-        const auto mst = prims(mat);
+    // Forward decls.
+    template<typename Mat>
+    inline auto prims(const Mat& mat) -> mst_parents<Mat>;
+    template<typename T>
+    inline auto sparse_prims(const csr_graph<T>& graph) -> std::vector<std::size_t>;
+    // Weight of the tree, every edge taken parent -> child.
+    template<typename Mat>
+    inline auto mst_weight(const Mat& mat, const mst_parents<Mat>& parent) -> std::size_t;
+    template<typename Mat, typename It>
+    inline auto tour_mst(const Mat& mat, const mst_parents<Mat>& parent, It visited_it, std::size_t root = 0) -> It;
 
-        auto visit_order = std::array<std::size_t, nodes + 1>{0}; // + 1 since we want a 0 at the end.
-        tour_mst(utils::bidimensional_access{ mst }, visit_order.begin() + 1); // + 1 since we want to skip the first 0.
+    template<typename Mat>
+    inline auto approx(const Mat& mat) -> result<Mat>
+    {
+        if(!utils::nodes(mat)) return {0, utils::make_node_array<std::size_t, 1>(mat)};
+        auto stats = instrument::recorder{"approx"};
+        auto visit_order = utils::make_node_array<std::size_t, 1>(mat); // + 1 since we want a 0 at the end.
+        tour_mst(mat, prims(mat), visit_order.begin());
+        stats.add(0, instrument::expanded, utils::nodes(mat));
 
-        auto cost = 0;
+        auto cost = std::size_t{0};
         for(std::size_t i = 1; i < visit_order.size(); ++i) {
             cost += mat[{
                 static_cast<std::size_t>( visit_order[i] ),
                 static_cast<std::size_t>( visit_order[i - 1] )}
             ];
         }
+        stats.add(0, instrument::lookups, visit_order.size() - 1);
+        stats.publish();
         return {cost, visit_order};
     }
 
-    template<typename T, std::size_t Cells>
-    inline auto prims(const utils::bidimensional_access<T, Cells>& mat) -> std::array<T, Cells>
+    // Dense O(n^2) Prim. key[v] is the cheapest edge from the tree to v (or the
+    // biggest T once v is in the tree), so each step is an argmin over key
+    // (vectorized when possible) and a pass relaxing the keys through the new node.
+    // The biggest T can be a real cost too, so tree membership is kept apart.
+    // Ties between nodes go to the lowest one (that's what argmin returns), and
+    // only then, while relaxing a node, ties between parents go to the lowest
+    // parent seen so far.
+    // Edges are weighted parent -> child, so relaxing walks a contiguous row.
+    template<typename Mat>
+    inline auto prims(const Mat& mat) -> mst_parents<Mat>
     {
-        auto mst = std::array<T, Cells>{0};
+        using T = typename Mat::value_type;
+        constexpr auto in_tree = std::numeric_limits<T>::max();
+        const auto nodes = utils::nodes(mat);
+
+        auto parent = utils::make_node_array<std::size_t>(mat, std::size_t{0});
+        auto key    = utils::make_node_array<T>(mat, in_tree);
+        auto added_to_tree = utils::make_node_array<char>(mat, char{false});
+        if(!nodes) return parent;
 
-        auto visited_nodes = std::set<std::size_t>{};
-        visited_nodes.insert(0);
-        auto unvisited_nodes = std::set<std::size_t>{};
-        for(auto i = 1; i < utils::ct_sqrt(Cells); ++i) { unvisited_nodes.insert(i); }
+        auto stats = instrument::recorder{"prims"};
+        auto added = std::size_t{0};
+        added_to_tree[added] = true;
+        for(std::size_t i = 1; i < nodes; ++i) { key[i] = mat[{i, added}]; }
+        stats.add(0, instrument::lookups, nodes - 1);
 
-        while(!unvisited_nodes.empty())
+        for(std::size_t step = 1; step < nodes; ++step)
         {
-            auto smallest_edge        = std::numeric_limits<T>::max();
-            auto smallest_edge_coords = std::tuple<std::size_t, std::size_t>{0, 0};
+            added = utils::argmin(key.data(), nodes);
+            // Only when every node left costs the biggest T, which ties with the tree.
+            if(added_to_tree[added]) { added = 0; while(added_to_tree[added]) ++added; }
+            key[added] = in_tree;
+            added_to_tree[added] = true;
+            stats.add(0, instrument::expanded);
+            stats.add(0, instrument::lookups, nodes);
 
-            // Find the smallest edge connecting to an unvisited node.
-            for(auto visited_node : visited_nodes)
+            for(std::size_t i = 0; i < nodes; ++i)
             {
-                for(auto unvisited_node : unvisited_nodes)
-                {
-                    if(mat[{visited_node, unvisited_node}] < smallest_edge) {
-                        smallest_edge        = mat[{visited_node, unvisited_node}];
-                        smallest_edge_coords = {visited_node, unvisited_node};
-                    }
+                const auto w = mat[{i, added}];
+                if(!added_to_tree[i] && (w < key[i] || (w == key[i] && added < parent[i]))) {
+                    key[i]    = w;
+                    parent[i] = added;
                 }
             }
+        }
 
-            visited_nodes.insert( std::get<1>(smallest_edge_coords) );
-            unvisited_nodes.erase( std::get<1>(smallest_edge_coords) );
+        stats.publish();
+        return parent;
+    }
+
+    // Prim with a binary heap (and lazy deletion) over a sparse graph, like the
+    // k_nearest candidate graph, in O(m log m). The graph should be symmetric.
+    // If it isn't connected this is a spanning forest, each component root
+    // being its own parent.
+    template<typename T>
+    inline auto sparse_prims(const csr_graph<T>& graph) -> std::vector<std::size_t>
+    {
+        const auto nodes = graph.nodes();
+        auto parent  = std::vector<std::size_t>(nodes);
+        auto in_tree = std::vector<char>(nodes, false);
 
-            mst[
-                std::get<0>(smallest_edge_coords) +
-                std::get<1>(smallest_edge_coords) * utils::ct_sqrt(Cells)
-            ] = smallest_edge;
+        using entry = std::tuple<T, std::size_t, std::size_t>; // weight, node, parent.
+        auto heap = std::priority_queue<entry, std::vector<entry>, std::greater<entry>>{};
+
+        for(std::size_t root = 0; root < nodes; ++root)
+        {
+            if(in_tree[root]) continue;
+            heap.push({T{}, root, root});
+            while(!heap.empty())
+            {
+                const auto [w, node, from] = heap.top();
+                heap.pop();
+                if(in_tree[node]) continue; // A stale entry, node was reached through a cheaper edge.
+                in_tree[node] = true;
+                parent[node]  = from;
+
+                for(auto e = graph.offsets[node]; e < graph.offsets[node + 1]; ++e) {
+                    if(!in_tree[graph.targets[e]]) heap.push({graph.weights[e], graph.targets[e], node});
+                }
+            }
         }
+        return parent;
+    }
 
-        return mst;
+    // Weight of the tree, every edge taken parent -> child.
+    template<typename Mat>
+    inline auto mst_weight(const Mat& mat, const mst_parents<Mat>& parent) -> std::size_t
+    {
+        auto weight = std::size_t{0};
+        for(std::size_t v = 0; v < parent.size(); ++v) {
+            if(parent[v] != v) weight += mat[{v, parent[v]}];
+        }
+        return weight;
     }
 
-    // Basically a BFS.
-    template<typename T, std::size_t Cells, typename It>
-    inline auto tour_mst(const utils::bidimensional_access<T, Cells>& mst, It&& visited_it, std::size_t node) -> void
+    // Preorder walk of the tree (a DFS), writing root and then every node in
+    // the order they are visited to visited_it. Returns the iterator past the
+    // last node written.
+    //
+    // The children of each node are first gathered from the parent array into
+    // CSR form with a counting sort:
+    //
+    //     parent   = {0, 0, 1, 0, 1}
+    //     offsets  = {0, 2, 4, 4, 4, 4}   node i's children are [offsets[i], offsets[i + 1])
+    //     children = {1, 3, 2, 4}
+    //
+    // and then walked with an explicit stack, so it is O(n) with no recursion.
+    // Children are visited in increasing order, like the original recursive walk.
+    template<typename Mat, typename It>
+    inline auto tour_mst(const Mat& mat, const mst_parents<Mat>& parent, It visited_it, std::size_t root) -> It
     {
-        // For each edge connected to node.
-        for(std::size_t i = 0; i < utils::ct_sqrt(Cells); ++i)
+        const auto nodes = utils::nodes(mat);
+        if(!nodes) return visited_it;
+
+        auto offsets  = utils::make_node_array<std::size_t, 1>(mat, std::size_t{0});
+        auto children = utils::make_node_array<std::size_t>(mat);
+        auto stack    = utils::make_node_array<std::size_t>(mat);
+
+        for(std::size_t v = 0; v < nodes; ++v) { if(v != root && parent[v] != v) ++offsets[parent[v] + 1]; }
+        for(std::size_t i = 0; i < nodes; ++i) { offsets[i + 1] += offsets[i]; }
+        {
+            // Where the next child of each node goes, the stack doubles as that cursor for now.
+            for(std::size_t i = 0; i < nodes; ++i) { stack[i] = offsets[i]; }
+            for(std::size_t v = 0; v < nodes; ++v) { if(v != root && parent[v] != v) children[stack[parent[v]]++] = v; }
+        }
+
+        auto top = std::size_t{0};
+        stack[top++] = root;
+        while(top)
         {
-            if(!mst[{node, i}]) continue;
-            // Visit it and their children.
-            *(visited_it++) = i;
-            tour_mst(mst, visited_it, i);
+            const auto node = stack[--top];
+            *(visited_it++) = node;
+            // Pushed backwards so the smallest child comes out first.
+            for(auto c = offsets[node + 1]; c-- > offsets[node];) { stack[top++] = children[c]; }
         }
+        return visited_it;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,181 @@
+/// Contains a batch solver for many instances at once.
+//
+// When there are a lot of small instances it pays more to solve several of
+// them at the same time (one per thread) than to split each one across all
+// the threads: every thread stays busy and nothing waits on the slowest one.
+//
+// A batch_solver owns a thread_pool that lives as long as it does, plus
+// scratch buffers for each worker (the Held-Karp tables, the biggest
+// allocation), so solving batch after batch reuses both.
+//
+// Each instance gets a strategy, by default exact up to exact_up_to nodes and
+// approx above that:
+// - exact:  held_karp up to 20 nodes, branch_and_bound above (up to 64).
+// - approx: approx followed by local_search.
+//
+// With a solution_cache (see cache.hpp) in the options, instances already
+// solved are answered from it, and the others start from the tour of a near
+// match when there is one: local_search improves it instead of the tour of
+// approx, branch_and_bound takes it as its upper bound (held_karp has no use
+// for it). Approx tours are cached as heuristic ones, so an exact solve of the
+// same matrix only starts from them. The cache can be shared with other
+// batch_solvers.
+//
+// Results are handed to on_result on the calling thread, in the order they
+// finish. If a solver (or on_result) throws, the rest of the batch still runs
+// and the first exception is rethrown at the end. If pick throws, nothing runs.
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <algorithm> // For std::max.
+#include <optional>
+#include <cstddef> // For std::size_t.
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <span>
+
+#include "utils.hpp"
+#include "tsp/result.hpp"
+#include "tsp/held_karp.hpp"
+#include "tsp/bnb.hpp"
+#include "tsp/approx.hpp"
+#include "tsp/local_search.hpp"
+#include "tsp/thread_pool.hpp"
+#include "tsp/cache.hpp"
+
+namespace tsp
+{
+    enum class batch_strategy { exact, approx };
+
+    struct batch_options
+    {
+        std::size_t threads     = default_workers();
+        std::size_t exact_up_to = 16; // Nodes, for the default strategy.
+        solution_cache* cache   = nullptr; // Not owned, must outlive the solver.
+    };
+
+    template<typename Mat>
+    struct batch_result
+    {
+        std::size_t index; // Of the instance in the batch.
+        batch_strategy strategy;
+        result<Mat> solution;
+        std::chrono::nanoseconds time;
+        std::size_t worker;
+    };
+
+    template<typename Mat>
+    class batch_solver
+    {
+    public:
+        explicit batch_solver(const batch_options& options = {})
+            : options{options}
+            , scratches(std::max<std::size_t>(1, options.threads))
+            , pool{options.threads}
+        {}
+
+        auto threads() const -> std::size_t { return pool.size(); }
+
+        // The default strategy.
+        auto pick(const Mat& mat) const -> batch_strategy
+        {
+            return utils::nodes(mat) <= options.exact_up_to ? batch_strategy::exact : batch_strategy::approx;
+        }
+
+        // Solves every instance, calling on_result(batch_result<Mat>&&) for
+        // each one as it finishes. Returns once they all did.
+        template<typename OnResult>
+        auto solve(std::span<const Mat> instances, OnResult&& on_result) -> void
+        {
+            solve(instances, [this](const Mat& mat, std::size_t) { return pick(mat); }, on_result);
+        }
+
+        // Same, but with pick(mat, index) choosing the strategy of each instance.
+        template<typename Pick, typename OnResult>
+        auto solve(std::span<const Mat> instances, Pick&& pick, OnResult&& on_result) -> void;
+
+    private:
+        struct alignas(utils::cache_line) scratch
+        {
+            held_karp_buffers held_karp;
+        };
+
+        auto run(const Mat& mat, batch_strategy strategy, scratch& buffers) -> result<Mat>
+        {
+            const auto solve = [&](const Mat& mat, const std::optional<result<Mat>>& start) -> result<Mat> {
+                if(strategy == batch_strategy::approx) { return std::get<0>(local_search(mat, start ? *start : approx(mat))); }
+                if(utils::nodes(mat) <= 20)            { return held_karp(mat, buffers.held_karp); }
+                return start ? branch_and_bound(mat, *start) : branch_and_bound(mat);
+            };
+            if(options.cache) return options.cache->solve(mat, solve, strategy == batch_strategy::exact);
+            return solve(mat, std::nullopt);
+        }
+
+        batch_options options;
+        std::vector<scratch> scratches; // One per worker.
+        thread_pool pool;               // Last, so its threads are joined before the scratches go away.
+    };
+}
+
+template<typename Mat>
+template<typename Pick, typename OnResult>
+inline auto tsp::batch_solver<Mat>::solve(std::span<const Mat> instances, Pick&& pick, OnResult&& on_result) -> void
+{
+    // Finished instances, from the workers to this thread.
+    struct finished
+    {
+        std::optional<batch_result<Mat>> result;
+        std::exception_ptr error;
+    };
+    // All picked before any job is submitted: if pick throws, no worker is using our locals yet.
+    auto strategies = std::vector<batch_strategy>{};
+    strategies.reserve(instances.size());
+    for(std::size_t i = 0; i < instances.size(); ++i) { strategies.push_back(pick(instances[i], i)); }
+
+    auto lock = std::mutex{};
+    auto done = std::condition_variable{};
+    auto queue = std::deque<finished>{};
+
+    for(std::size_t i = 0; i < instances.size(); ++i)
+    {
+        const auto strategy = strategies[i];
+        pool.submit([&, i, strategy](std::size_t worker)
+        {
+            auto item = finished{};
+            try
+            {
+                const auto start = std::chrono::steady_clock::now();
+                auto solution = run(instances[i], strategy, scratches[worker]);
+                item.result = batch_result<Mat>{i, strategy, std::move(solution), std::chrono::steady_clock::now() - start, worker};
+            }
+            catch(...) { item.error = std::current_exception(); }
+
+            // Notified with the lock held, once the last item is taken solve() returns and done is gone.
+            auto guard = std::scoped_lock{lock};
+            queue.push_back(std::move(item));
+            done.notify_one();
+        });
+    }
+
+    auto first_error = std::exception_ptr{};
+    for(std::size_t received = 0; received < instances.size(); ++received)
+    {
+        auto item = finished{};
+        {
+            auto guard = std::unique_lock{lock};
+            done.wait(guard, [&]{ return !queue.empty(); });
+            item = std::move(queue.front());
+            queue.pop_front();
+        }
+        // Even if on_result throws we keep going, the workers still use our locals.
+        if(!item.error) {
+            try { on_result(std::move(*item.result)); }
+            catch(...) { item.error = std::current_exception(); }
+        }
+        if(item.error && !first_error) first_error = item.error;
+    }
+    if(first_error) std::rethrow_exception(first_error);
+}
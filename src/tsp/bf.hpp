@@ -28,6 +28,21 @@
 // > the same spot. Limiting it makes sure we won't double check
 // > some path we tried before.
 //
+// When the matrix is symmetric (going from X to Y costs the same as going
+// from Y to X) there's still one more repetition: every cycle is also tried
+// backwards, {0, 1, 2, 3, 4, 5} costs the same as {0, 5, 4, 3, 2, 1}.
+// So for those we only keep the permutations whose second node is smaller
+// than the last one, which is true for exactly one of the two directions:
+//
+//     {0, 1, 2, 3, 4, 5}  kept,    1 < 5
+//     {0, 5, 4, 3, 2, 1}  skipped, 5 > 1
+//
+// The strategies that build the permutations a prefix at a time also skip
+// every prefix whose nodes left are all smaller than its second one, since
+// none of them can end the cycle. Asymmetric matrices go through every
+// permutation like before, and so does a search with fix1, since the other
+// direction of its cycles doesn't begin with {fix0, fix1, ...}.
+//
 // We add a 0, to the end of each permutation and then we can do the
 // following transformation to get the {X, Y}s we should visit:
 //
@@ -55,28 +70,159 @@
 // Et voilà.
 #pragma once
 
-#include <algorithm> // For std::next_permutation and std::generate.
+#include <algorithm> // For std::next_permutation, std::generate and std::reverse.
 #include <optional>
 #include <limits> // For std::numeric_limits.
+#include <atomic>
 #include <thread>
+#include <mutex>
 #include <tuple>
+#include <vector>
 #include <array>
 
 #include "utils.hpp"
+#include "tsp/result.hpp"
+#include "tsp/work_stealing.hpp"
+#include "tsp/instrument.hpp"
+#include "tsp/anytime.hpp"
+#include "tsp/approx.hpp"
+#include "tsp/tour_eval.hpp"
+#include "tsp/unrolled.hpp"
 
 namespace tsp
 {
+    // How seq_brute_force goes through the permutations.
+    enum class bf_strategy
+    {
+        automatic,   // unrolled when the matrix has one, full otherwise.
+        unrolled,    // Search generated at compile time, see unrolled.hpp (full when there isn't one).
+        full,        // std::next_permutation and the whole cycle is summed every time.
+        incremental, // Only what changed is summed again, see seq_brute_force_incremental.
+        batched,     // Scored 16 at a time with SIMD gathers, see seq_brute_force_batched.
+    };
+
     // As we'll see later, the fix is needed to make this usable by the parallel implementation.
-    template<typename T, std::size_t Cells>
+    template<typename Mat>
     inline auto seq_brute_force(
-        const utils::bidimensional_access<T, Cells>& mat,
-        const std::optional<int> fix1 = {}
-    ) -> std::tuple< std::size_t, std::array<std::size_t, utils::ct_sqrt(Cells) + 1> >;
+        const Mat& mat,
+        const std::optional<int> fix1 = {},
+        const bf_strategy strategy = bf_strategy::automatic
+    ) -> result<Mat>;
+
+    // Brute forces the permutations of v[first, v.size() - 1), which must start sorted.
+    template<typename Mat>
+    inline auto seq_brute_force_incremental(
+        const Mat& mat,
+        cicle<Mat> v,
+        const std::size_t first
+    ) -> result<Mat>;
+
+    // Same as seq_brute_force_incremental.
+    template<typename Mat>
+    inline auto seq_brute_force_batched(
+        const Mat& mat,
+        cicle<Mat> v,
+        const std::size_t first
+    ) -> result<Mat>;
+
+    // threads = auto_threads (the default) runs default_workers() threads, or
+    // unrolled_brute_force on the calling thread when mat has one. Any other
+    // amount always runs that many, so they can be compared.
+    constexpr auto auto_threads = std::size_t{0};
 
-    template<typename T, std::size_t Cells>
+    template<typename Mat>
     inline auto par_brute_force(
-        const utils::bidimensional_access<T, Cells>& mat
-    ) -> std::tuple< std::size_t, std::array<std::size_t, utils::ct_sqrt(Cells) + 1> >;
+        const Mat& mat,
+        const std::size_t threads = auto_threads,
+        const bool pin_threads = false
+    ) -> result<Mat>;
+
+    // Starting from the tour of start as the best one so far, any tour of mat
+    // will do (like one of a similar matrix, see cache.hpp).
+    template<typename Mat>
+    inline auto par_brute_force(
+        const Mat& mat,
+        const result<Mat>& start,
+        const std::size_t threads = auto_threads,
+        const bool pin_threads = false
+    ) -> result<Mat>;
+
+    // Anytime versions that stop when limits runs out, see anytime.hpp. They
+    // start from the tour of tsp::approx and the sequential one uses the
+    // incremental strategy.
+    template<typename Mat>
+    inline auto seq_brute_force(const Mat& mat, const budget& limits) -> anytime_result<Mat>;
+
+    template<typename Mat>
+    inline auto par_brute_force(
+        const Mat& mat,
+        const budget& limits,
+        const std::size_t threads = default_workers(),
+        const bool pin_threads = false
+    ) -> anytime_result<Mat>;
+}
+
+namespace tsp::detail
+{
+    // Like std::next_permutation over v[first, nodes), but returns the pivot
+    // (the first index that changed) or nodes when there are no more permutations.
+    template<typename Cicle>
+    inline auto next_permutation(Cicle& v, std::size_t first, std::size_t nodes) -> std::size_t
+    {
+        if(first + 1 >= nodes) return nodes;
+        auto i = nodes - 1;
+        while(i > first && v[i - 1] >= v[i]) --i;
+        if(i == first) return nodes;
+        const auto pivot = i - 1;
+
+        auto j = nodes - 1;
+        while(v[j] <= v[pivot]) --j;
+        std::swap(v[pivot], v[j]);
+        std::reverse(v.begin() + pivot + 1, v.begin() + nodes);
+        return pivot;
+    }
+
+    // The search of seq_brute_force_incremental. Asks stop(lowest_cost, v)
+    // before every permutation and returns whether it got through all of them.
+    template<typename Mat, typename Stop>
+    inline auto incremental_search(
+        const Mat& mat,
+        cicle<Mat>& v,
+        const std::size_t first,
+        std::size_t& lowest_cost,
+        cicle<Mat>& smallest_cicle,
+        Stop&& stop
+    ) -> bool;
+
+    // The search of par_brute_force, starting from the given best tour, and
+    // stopping when limits (if any) runs out.
+    template<typename Mat>
+    inline auto par_search(
+        const Mat& mat,
+        const std::size_t threads,
+        const bool pin_threads,
+        std::size_t lowest_cost,
+        cicle<Mat> smallest_cicle,
+        const budget* limits
+    ) -> anytime_result<Mat>;
+
+    // Fraction of the permutations of v[first, nodes) that come before v, in lexicographic order.
+    template<typename Cicle>
+    inline auto permutation_rank(const Cicle& v, std::size_t first, std::size_t nodes) -> double
+    {
+        // The Lehmer code of v: each position contributes how many of the
+        // elements after it are smaller, over the permutations it spans.
+        auto rank  = 0.0;
+        auto share = 1.0;
+        for(auto i = first; i < nodes; ++i)
+        {
+            share /= static_cast<double>(nodes - i);
+            auto smaller = std::size_t{0};
+            for(auto j = i + 1; j < nodes; ++j) { smaller += v[j] < v[i]; }
+            rank += smaller * share;
+        }
+        return rank;
+    }
 }
 
 // This is a single threaded (sequential) brute_force, where we can add a fix (fix1),
@@ -88,17 +234,17 @@ namespace tsp
 // for the combinations beginning in {fix0, fix1, ...}, this is useful for splitting
 // up the work between multiple threads, by default it is set to nullopt (not present).
 // Setting it to some number will enable it.
-template<typename T, std::size_t Cells>
+template<typename Mat>
 inline auto tsp::seq_brute_force(
-    const utils::bidimensional_access<T, Cells>& mat,
-    const std::optional<int> fix1
-) -> std::tuple< std::size_t, std::array<std::size_t, utils::ct_sqrt(Cells) + 1> >
+    const Mat& mat,
+    const std::optional<int> fix1,
+    const bf_strategy strategy
+) -> result<Mat>
 {
-    auto smallest_cicle = std::array<std::size_t, utils::ct_sqrt(Cells) + 1 >{};
-    auto v = std::array<
-        std::size_t,
-        utils::ct_sqrt(Cells) + 1 // + 1 since we want an additional 0 at the end.
-    >{};
+    if(utils::nodes(mat) < 2) { return {0, utils::make_node_array<std::size_t, 1>(mat)}; }
+
+    auto smallest_cicle = utils::make_node_array<std::size_t, 1>(mat);
+    auto v = utils::make_node_array<std::size_t, 1>(mat); // + 1 since we want an additional 0 at the end.
     v[0] = 0;
     v[1] = fix1.value_or(1);
 
@@ -111,15 +257,30 @@ inline auto tsp::seq_brute_force(
         }
     );
 
-    auto lowest_cost = std::numeric_limits<std::size_t>::max();
+    if constexpr(has_unrolled_v<Mat>) {
+        if(strategy == bf_strategy::automatic || strategy == bf_strategy::unrolled) { return unrolled_brute_force(mat, fix1); }
+    }
 
     const auto fix_index = int{ !!fix1 };
-    while( std::next_permutation(v.begin() + 1 + fix_index, v.end() - 1) )
+    if(strategy == bf_strategy::incremental) { return seq_brute_force_incremental(mat, v, 1 + fix_index); }
+    if(strategy == bf_strategy::batched)     { return seq_brute_force_batched(mat, v, 1 + fix_index); }
+
+    auto lowest_cost = std::numeric_limits<std::size_t>::max();
+    auto stats = instrument::recorder{"seq_brute_force"};
+    const auto one_way = !fix1 && utils::is_symmetric(mat);
+    const auto last    = v.size() - 2;
+
+    // v starts as the first (sorted) permutation, so it is scored before stepping.
+    const auto step = [&]{ return std::next_permutation(v.begin() + 1 + fix_index, v.end() - 1); };
+    for(auto more = true; more; more = step())
     {
+        if(one_way && v[1] > v[last]) continue; // The same cycle backwards.
+        stats.add(0, instrument::permutations);
         auto current_cost = decltype(lowest_cost){0};
         for(std::size_t i = 1; i < v.size(); ++i) {
+            stats.add(0, instrument::lookups);
             current_cost += mat[ {static_cast<std::size_t>( v[i] ), static_cast<std::size_t>( v[i - 1] )} ];
-            if(current_cost >= lowest_cost) break;
+            if(current_cost >= lowest_cost) { stats.add(0, instrument::prunes); break; }
         }
 
         if(current_cost < lowest_cost) {
@@ -128,43 +289,453 @@ inline auto tsp::seq_brute_force(
         }
     }
 
+    stats.publish();
     return {lowest_cost, smallest_cicle};
 }
 
-// Here we will spawn sqrt(Cells) - 1 threads and each of them will be responsible
-// for a different fix1.
-// For example:
-//     Thread 1 is responsible for {0, 1, 2, 3, 4, 5} to {0, 1, 5, 4, 3, 2}
-//     Thread 2 is responsible for {0, 2, 1, 3, 4, 5} to {0, 2, 5, 4, 3, 1}
-//     ...
-//     Thread 5 is responsible for {0, 5, 1, 2, 3, 4} to {0, 5, 4, 3, 2, 1}
-// And so on.
-template<typename T, std::size_t Cells>
-inline auto tsp::par_brute_force(const utils::bidimensional_access<T , Cells>& mat)
--> std::tuple< std::size_t, std::array<std::size_t, utils::ct_sqrt(Cells) + 1> >
+// Going from one permutation to the next with std::next_permutation only
+// touches a suffix of v: it finds the pivot (the last i with v[i] < v[i + 1]),
+// swaps it with the next bigger element after it and reverses what's after it.
+// On average that suffix is less than 3 elements long, no matter the size of v.
+//
+// So we keep prefix[i], the cost of the path v[0] -> ... -> v[i], and after each
+// step only sum again from the pivot on, which makes each new permutation cost
+// constant work (amortized) instead of O(nodes).
+//
+// Having the prefix costs around also makes pruning much stronger, once a
+// prefix alone is not cheaper than the best cycle every permutation sharing it
+// can be skipped at once, by reversing the (sorted) nodes after it into the
+// last permutation in lexicographic order.
+template<typename Mat>
+inline auto tsp::seq_brute_force_incremental(
+    const Mat& mat,
+    cicle<Mat> v,
+    const std::size_t first
+) -> result<Mat>
+{
+    auto smallest_cicle = v;
+    auto lowest_cost    = std::numeric_limits<std::size_t>::max();
+    detail::incremental_search(mat, v, first, lowest_cost, smallest_cicle, [](std::size_t, const cicle<Mat>&) { return false; });
+    return {lowest_cost, smallest_cicle};
+}
+
+template<typename Mat, typename Stop>
+inline auto tsp::detail::incremental_search(
+    const Mat& mat,
+    cicle<Mat>& v,
+    const std::size_t first,
+    std::size_t& lowest_cost,
+    cicle<Mat>& smallest_cicle,
+    Stop&& stop
+) -> bool
 {
-    auto workers = std::array<
-        std::thread,
-        utils::ct_sqrt(Cells) - 1
-    >{};
-    auto results = std::array<
-        std::tuple< std::size_t, std::array<std::size_t, utils::ct_sqrt(Cells) + 1> >,
-        utils::ct_sqrt(Cells) - 1
-    >{};
-
-    for(decltype(results.size()) i = 0; i < results.size(); ++i)
+    const auto nodes = utils::nodes(mat);
+
+    auto prefix  = utils::make_node_array<std::size_t>(mat);
+    auto stats   = instrument::recorder{"seq_brute_force_incremental"};
+    const auto one_way = first == 1 && utils::is_symmetric(mat);
+
+    auto changed = std::size_t{1};
+    while(changed < nodes)
+    {
+        if(stop(lowest_cost, v)) { stats.publish(); return false; }
+
+        // What comes after changed is sorted, so v[nodes - 1] is the biggest
+        // node that could end the cycle. When it's smaller than v[1] all the
+        // permutations sharing v[0..changed] are cycles we'll try backwards.
+        if(one_way && v[nodes - 1] < v[1])
+        {
+            stats.add(0, instrument::prunes);
+            if(changed < first) break;
+            std::reverse(v.begin() + changed + 1, v.begin() + nodes);
+            changed = next_permutation(v, first, nodes);
+            continue;
+        }
+
+        stats.add(0, instrument::permutations);
+        auto pruned_at = nodes;
+        for(auto i = changed; i < nodes; ++i)
+        {
+            stats.add(0, instrument::lookups);
+            prefix[i] = prefix[i - 1] + mat[{v[i], v[i - 1]}];
+            if(prefix[i] >= lowest_cost) { pruned_at = i; break; }
+        }
+
+        if(pruned_at == nodes)
+        {
+            stats.add(0, instrument::lookups);
+            const auto current_cost = prefix[nodes - 1] + mat[{v[nodes], v[nodes - 1]}];
+            if(current_cost < lowest_cost) {
+                lowest_cost    = current_cost;
+                smallest_cicle = v;
+            }
+        }
+        else
+        {
+            stats.add(0, instrument::prunes);
+            // The fixed part alone is too expensive, nothing left to try.
+            if(pruned_at < first) break;
+            // Everything after pruned_at is still in ascending order, jump to its last permutation.
+            std::reverse(v.begin() + pruned_at + 1, v.begin() + nodes);
+        }
+
+        changed = next_permutation(v, first, nodes);
+    }
+
+    stats.publish();
+    return true;
+}
+
+// Instead of summing one permutation at a time we write 16 of them side by side
+// and score them all at once with a tour_evaluator (see tour_eval.hpp), which
+// does one SIMD gather per position for all of them.
+//
+// Stepping std::next_permutation costs more than the scoring, so it only
+// steps the nodes before the last 4 (tail), which are kept sorted, and the
+// 24 orders of the tail come from a table made once. That's still the
+// lexicographic order:
+//
+//     {0, ..., 6, 7, 8, 9, 10} -> tail in every order, 24 permutations
+//     {0, ..., 6, 10, 9, 8, 7} -> reversed, so next_permutation steps the prefix
+//     {0, ..., 7, 6, 8, 9, 10} -> tail in every order again
+//
+// The cost of the path up to the tail is kept like in the incremental strategy,
+// and prefixes that are already too expensive are skipped with every order of
+// their tail. The permutations of a batch only differ from the smallest pivot
+// of the steps between them on, so the path before it is summed once (and
+// when it is already too expensive the batch isn't scored at all) and only the
+// rest is gathered. Only what changed is written again too: a lane last held the
+// permutation 16 steps back, so it only differs from the pivots of those steps on.
+template<typename Mat>
+inline auto tsp::seq_brute_force_batched(
+    const Mat& mat,
+    cicle<Mat> v,
+    const std::size_t first
+) -> result<Mat>
+{
+    constexpr auto lanes = tour_evaluator::lanes;
+    const auto nodes  = utils::nodes(mat);
+    const auto length = nodes + 1;
+    const auto tail   = nodes - std::min<std::size_t>(4, nodes - std::min(first, nodes));
+
+    // Every order of the tail, as indices into it, and where each one starts to differ from the one before.
+    auto orders = std::vector<std::array<std::uint8_t, 4>>{};
+    auto order_pivots = std::vector<std::size_t>{};
+    {
+        auto order = std::array<std::uint8_t, 4>{0, 1, 2, 3};
+        const auto end = order.begin() + (nodes - tail);
+        do
+        {
+            auto pivot = tail;
+            if(!orders.empty()) { while(orders.back()[pivot - tail] == order[pivot - tail]) ++pivot; }
+            orders.push_back(order);
+            order_pivots.push_back(pivot);
+        } while(std::next_permutation(order.begin(), end));
+    }
+
+    const auto evaluator = tour_evaluator{mat};
+    const auto one_way   = first == 1 && utils::is_symmetric(mat);
+    auto paths = std::vector<std::int32_t, utils::aligned_allocator<std::int32_t>>(length * lanes);
+    auto costs = std::array<std::size_t, lanes>{};
+    for(std::size_t pos = 0; pos < length; ++pos) {
+        for(std::size_t lane = 0; lane < lanes; ++lane) { paths[pos * lanes + lane] = static_cast<std::int32_t>(v[pos]); }
+    }
+
+    auto smallest_cicle = v;
+    auto lowest_cost    = std::numeric_limits<std::size_t>::max();
+    auto stats          = instrument::recorder{"seq_brute_force_batched"};
+
+    // Smallest pivot of the steps to the permutations of this batch and of the previous one.
+    auto changed          = nodes;
+    auto previous_changed = first;
+    auto count            = std::size_t{0};
+    const auto score = [&]
     {
-        workers[i] = std::thread{
-            [&, i, fix1 = i + 1]{ results[i] = seq_brute_force(mat, fix1); }
-        };
+        stats.add(0, instrument::permutations, count);
+
+        // Every lane shares v[0..changed), the edges up to v[changed - 1] are the same.
+        const auto start = std::max<std::size_t>(changed, 1) - 1;
+        auto shared_cost = std::size_t{0};
+        for(std::size_t pos = 1; pos <= start; ++pos) {
+            shared_cost += mat[{static_cast<std::size_t>(paths[pos * lanes]), static_cast<std::size_t>(paths[(pos - 1) * lanes])}];
+        }
+        stats.add(0, instrument::lookups, start);
+
+        if(shared_cost < lowest_cost)
+        {
+            evaluator.score(paths.data() + start * lanes, length - start, costs.data());
+            stats.add(0, instrument::lookups, count * (length - 1 - start));
+
+            // Only the first count lanes hold new permutations.
+            const auto best = utils::argmin(costs.data(), count);
+            if(shared_cost + costs[best] < lowest_cost) {
+                lowest_cost = shared_cost + costs[best];
+                for(std::size_t pos = 0; pos < length; ++pos) { smallest_cicle[pos] = static_cast<std::size_t>(paths[pos * lanes + best]); }
+            }
+        }
+        else { stats.add(0, instrument::prunes); }
+
+        previous_changed = changed;
+        changed = nodes;
+        count   = 0;
+    };
+
+    // prefix[i] is the cost of the path v[0] -> ... -> v[i], for i < tail.
+    auto prefix = utils::make_node_array<std::size_t>(mat);
+    // Smallest pivot of the prefixes skipped since the last one written.
+    auto skipped = nodes;
+    auto prefix_pivot = first;
+    for(auto sum_from = std::size_t{1}; prefix_pivot < nodes; sum_from = prefix_pivot)
+    {
+        auto pruned_at = tail;
+        for(auto i = sum_from; i < tail; ++i)
+        {
+            stats.add(0, instrument::lookups);
+            prefix[i] = prefix[i - 1] + mat[{v[i], v[i - 1]}];
+            if(prefix[i] >= lowest_cost) { pruned_at = i; break; }
+        }
+        // Like in the incremental strategy, nothing after the pivot can end the cycle.
+        if(one_way && pruned_at == tail && v[nodes - 1] < v[1]) pruned_at = prefix_pivot;
+        if(pruned_at < tail)
+        {
+            // Like in the incremental strategy, jump to the last permutation sharing v[0..pruned_at].
+            stats.add(0, instrument::prunes);
+            if(pruned_at < first) break;
+            std::reverse(v.begin() + pruned_at + 1, v.begin() + nodes);
+            skipped = std::min(skipped, prefix_pivot);
+            prefix_pivot = detail::next_permutation(v, first, nodes);
+            continue;
+        }
+
+        for(std::size_t k = 0; k < orders.size(); ++k)
+        {
+            changed = std::min(changed, k ? order_pivots[k] : std::min(skipped, prefix_pivot));
+            if(one_way)
+            {
+                // The second node is only part of the tail when there are very few nodes.
+                const auto second = tail > 1 ? v[1] : v[tail + orders[k][1 - tail]];
+                if(second > v[tail + orders[k][nodes - 1 - tail]]) continue;
+            }
+            for(auto pos = std::min(previous_changed, changed); pos < tail; ++pos) {
+                paths[pos * lanes + count] = static_cast<std::int32_t>(v[pos]);
+            }
+            for(auto pos = tail; pos < nodes; ++pos) {
+                paths[pos * lanes + count] = static_cast<std::int32_t>(v[tail + orders[k][pos - tail]]);
+            }
+            if(++count == lanes) score();
+        }
+        skipped = nodes;
+
+        std::reverse(v.begin() + tail, v.begin() + nodes);
+        prefix_pivot = detail::next_permutation(v, first, nodes);
     }
-    for(auto& worker : workers) { worker.join(); }
+    if(count) score();
+
+    stats.publish();
+    return {lowest_cost, smallest_cicle};
+}
+
+template<typename Mat>
+inline auto tsp::seq_brute_force(const Mat& mat, const budget& limits) -> anytime_result<Mat>
+{
+    const auto nodes = utils::nodes(mat);
+    auto [lowest_cost, smallest_cicle] = approx(mat);
 
-    auto lowest_i = 0;
-    for(std::size_t i = 0 ; i < results.size(); ++i) {
-        if( std::get<0>(results[i]) < std::get<0>(results[lowest_i]) ) {
-            lowest_i = i;
+    auto v = utils::make_node_array<std::size_t, 1>(mat);
+    for(std::size_t i = 0; i < nodes; ++i) { v[i] = i; }
+    v[nodes] = 0;
+
+    // v is the next permutation to try, so its rank is how much is done.
+    auto checker = detail::budget_checker{limits, 4096};
+    const auto finished = detail::incremental_search(mat, v, 1, lowest_cost, smallest_cicle,
+        [&](std::size_t incumbent, const cicle<Mat>& current) {
+            return checker.tick(incumbent, [&]{ return detail::permutation_rank(current, 1, nodes); });
         }
+    );
+
+    const auto covered = finished ? 1.0 : detail::permutation_rank(v, 1, nodes);
+    checker.finish(lowest_cost, covered);
+    return {lowest_cost, smallest_cicle, finished, covered};
+}
+
+// Here we split the permutations by their prefixes and let a pool of threads
+// (one per hardware thread by default, pinned to a core each with pin_threads)
+// go through them with work stealing.
+//
+// A task is a prefix, it starts as just {0} and while there are too many
+// permutations left behind a prefix it gets split into longer ones:
+//     {0}       -> {0, 1}, {0, 2}, ..., {0, 5}
+//     {0, 1}    -> {0, 1, 2}, {0, 1, 3}, ..., {0, 1, 5}
+//     ...
+// Small enough prefixes are brute forced like in seq_brute_force, but only
+// over the nodes after the prefix, whose cost is only summed once.
+//
+// All the workers share the lowest cost found so far through an atomic, so
+// a tour found by one of them makes every other one prune earlier (and whole
+// prefixes that are already too expensive are skipped).
+//
+// Unless a thread count is given, instances small enough for
+// unrolled_brute_force are solved by it on the calling thread instead, it
+// finishes p2 in about a microsecond, far less than it takes to start the threads.
+template<typename Mat>
+inline auto tsp::par_brute_force(
+    const Mat& mat,
+    const std::size_t threads,
+    const bool pin_threads
+) -> result<Mat>
+{
+    if constexpr(has_unrolled_v<Mat>) { if(threads == auto_threads) return unrolled_brute_force(mat); }
+
+    auto answer = detail::par_search(
+        mat, threads == auto_threads ? default_workers() : threads, pin_threads,
+        std::numeric_limits<std::size_t>::max(), utils::make_node_array<std::size_t, 1>(mat),
+        nullptr
+    );
+    return {answer.cost, answer.tour};
+}
+
+template<typename Mat>
+inline auto tsp::par_brute_force(
+    const Mat& mat,
+    const result<Mat>& start,
+    const std::size_t threads,
+    const bool pin_threads
+) -> result<Mat>
+{
+    // The unrolled kernels are done before a start would pay off.
+    if constexpr(has_unrolled_v<Mat>) { if(threads == auto_threads) return unrolled_brute_force(mat); }
+
+    const auto& [cost, tour] = start;
+    auto answer = detail::par_search(mat, threads == auto_threads ? default_workers() : threads, pin_threads, cost, tour, nullptr);
+    return {answer.cost, answer.tour};
+}
+
+template<typename Mat>
+inline auto tsp::par_brute_force(
+    const Mat& mat,
+    const budget& limits,
+    const std::size_t threads,
+    const bool pin_threads
+) -> anytime_result<Mat>
+{
+    const auto [cost, tour] = approx(mat);
+    return detail::par_search(mat, threads, pin_threads, cost, tour, &limits);
+}
+
+template<typename Mat>
+inline auto tsp::detail::par_search(
+    const Mat& mat,
+    const std::size_t threads,
+    const bool pin_threads,
+    std::size_t lowest,
+    cicle<Mat> smallest,
+    const budget* limits
+) -> anytime_result<Mat>
+{
+    const auto nodes = utils::nodes(mat);
+    if(nodes < 2) { return {0, utils::make_node_array<std::size_t, 1>(mat), true, 1.0}; }
+    // Prefixes with more than this amount of nodes left get split (9! = 362880 permutations).
+    constexpr auto split_above = std::size_t{9};
+
+    using cicle_t = cicle<Mat>;
+    // v[0..fixed] is the prefix, the rest of the nodes come after it in sorted order.
+    struct prefix
+    {
+        cicle_t v;
+        std::size_t fixed;
+    };
+
+    auto lowest_cost    = std::atomic<std::size_t>{ lowest };
+    auto smallest_cicle = smallest;
+    auto smallest_lock  = std::mutex{};
+
+    // Only used with limits. share[f] is the fraction of the search space
+    // behind a prefix with f fixed nodes, added to covered once it is done.
+    auto stopping = std::atomic<bool>{false};
+    auto covered  = std::atomic<double>{0};
+    auto share    = std::vector<double>(nodes, 1.0);
+    for(std::size_t f = 1; f < nodes; ++f) { share[f] = share[f - 1] / static_cast<double>(nodes - f); }
+    // Every worker ticks its own checker on every permutation, one per cache line so they don't share any.
+    struct alignas(utils::cache_line) checker_slot { budget_checker checker; };
+    auto checkers = std::vector<checker_slot>{};
+    if(limits) {
+        checkers.reserve(std::max<std::size_t>(1, threads));
+        // Only the first worker reports progress.
+        for(std::size_t i = 0; i < std::max<std::size_t>(1, threads); ++i) { checkers.push_back({budget_checker{*limits, 4096, i == 0}}); }
     }
-    return results[lowest_i];
+    const auto done = [&](const prefix& p) { if(limits) covered.fetch_add(share[p.fixed], std::memory_order_relaxed); };
+
+    auto root = prefix{ utils::make_node_array<std::size_t, 1>(mat), 0 };
+    for(std::size_t i = 0; i < nodes; ++i) { root.v[i] = i; }
+    root.v[nodes] = 0;
+
+    // The rest of a prefix is sorted, so v[nodes - 1] is the biggest node that
+    // could end its cycles, and when it's smaller than v[1] they are all tried
+    // backwards by some other prefix.
+    const auto one_way   = utils::is_symmetric(mat);
+    const auto backwards = [&](const prefix& p) { return one_way && p.fixed >= 1 && p.v[nodes - 1] < p.v[1]; };
+
+    auto stats = instrument::recorder{"par_brute_force", std::max<std::size_t>(1, threads)};
+
+    run_work_stealing(root, [&](prefix& p, std::size_t worker, auto& deques)
+    {
+        if(stopping.load(std::memory_order_relaxed)) return;
+        [[maybe_unused]] const auto busy = stats.time(worker);
+        auto prefix_cost = std::size_t{0};
+        for(std::size_t i = 1; i <= p.fixed; ++i) { prefix_cost += mat[{p.v[i], p.v[i - 1]}]; }
+        stats.add(worker, instrument::lookups, p.fixed);
+        if(prefix_cost >= lowest_cost.load(std::memory_order_relaxed)) { stats.add(worker, instrument::skipped); done(p); return; }
+
+        if(nodes - 1 - p.fixed > split_above)
+        {
+            stats.add(worker, instrument::expanded);
+            for(std::size_t i = p.fixed + 1; i < nodes; ++i)
+            {
+                auto child = p;
+                // Bring v[i] right after the prefix while keeping the rest sorted.
+                std::rotate(child.v.begin() + p.fixed + 1, child.v.begin() + i, child.v.begin() + i + 1);
+                ++child.fixed;
+                if(backwards(child)) { stats.add(worker, instrument::skipped); done(child); continue; }
+                deques.push(worker, child);
+            }
+            return;
+        }
+
+        auto& v = p.v;
+        do
+        {
+            if(limits && (stopping.load(std::memory_order_relaxed) || checkers[worker].checker.tick(
+                lowest_cost.load(std::memory_order_relaxed),
+                [&]{ return covered.load(std::memory_order_relaxed); }
+            ))) {
+                stopping.store(true, std::memory_order_relaxed);
+                return;
+            }
+            if(one_way && v[1] > v[nodes - 1]) continue; // The same cycle backwards.
+            stats.add(worker, instrument::permutations);
+            const auto bound = lowest_cost.load(std::memory_order_relaxed);
+            auto current_cost = prefix_cost;
+            for(std::size_t i = p.fixed + 1; i < v.size(); ++i) {
+                stats.add(worker, instrument::lookups);
+                current_cost += mat[ {v[i], v[i - 1]} ];
+                if(current_cost >= bound) { stats.add(worker, instrument::prunes); break; }
+            }
+
+            if(current_cost < bound)
+            {
+                auto lock = std::scoped_lock{smallest_lock};
+                if(current_cost < lowest_cost.load(std::memory_order_relaxed)) {
+                    lowest_cost.store(current_cost, std::memory_order_relaxed);
+                    smallest_cicle = v;
+                }
+            }
+        } while( std::next_permutation(v.begin() + p.fixed + 1, v.end() - 1) );
+        done(p);
+    }, threads, pin_threads);
+
+    stats.publish();
+    const auto optimal  = !stopping.load();
+    const auto fraction = optimal ? 1.0 : std::min(1.0, covered.load());
+    if(limits) checkers.front().checker.finish(lowest_cost.load(), fraction);
+    return {lowest_cost.load(), smallest_cicle, optimal, fraction};
 }
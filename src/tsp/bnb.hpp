@@ -0,0 +1,486 @@
+/// Contains a branch-and-bound exact solver.
+//
+// Like the brute force we build tours starting from node 0, but instead of
+// generating whole permutations we extend a partial path one node at a time:
+//
+//     {0}
+//     {0, 1}            {0, 2}            ...
+//     {0, 1, 2} ...     {0, 2, 1} ...
+//
+// For each partial path we compute a lower bound on the cost of *any* tour
+// that starts with it, if that bound is not smaller than the best tour found
+// so far (the upper bound) the whole subtree is skipped.
+//
+// The bounds are all admissible (never bigger than the real cost), so pruning
+// never throws away the optimal tour:
+//
+// - Cheapest two edges: every node still to be visited needs one edge in and
+//   one edge out, the last node of the path needs an edge out and node 0 needs
+//   an edge in, so half the sum of the cheapest incident edges is a bound.
+// - Reduced cost matrix: the rows that still need an outgoing edge and the
+//   columns that still need an incoming edge are reduced by their minimums,
+//   the sum of the reductions is a bound (as in Little et al.).
+// - Minimum spanning tree: the rest of the tour is an edge out of the last
+//   node, a path through every unvisited node and an edge back into 0, and
+//   that path costs at least as much as a spanning tree of the unvisited nodes.
+//   The costs used here carry node penalties found once at the root with the
+//   Held-Karp 1-tree subgradient method, which tightens the bound a lot.
+//
+// The cheap bound is checked first and the more expensive ones only run when
+// it fails to prune.
+//
+// The search starts with the tour from tsp::approx (or the one it's given) as
+// the upper bound, and if the matrix is symmetric the weight of the tree from
+// tsp::prims is used as a root bound, stopping right away when that tour
+// already hit it.
+//
+// The overload taking a budget (see anytime.hpp) stops when it runs out and
+// returns the best tour so far. The fraction covered adds up the share of the
+// tours behind every partial path that was pruned: a path with d nodes after
+// 0 stands for 1/((n-1)(n-2)...(n-d)) of them.
+#pragma once
+
+#include <algorithm> // For std::sort, std::copy and std::min.
+#include <cstdint> // For std::uint64_t.
+#include <stdexcept> // For std::length_error.
+#include <limits> // For std::numeric_limits.
+#include <vector>
+#include <queue>
+#include <tuple>
+#include <array>
+
+#include "utils.hpp"
+#include "tsp/result.hpp"
+#include "tsp/approx.hpp"
+#include "tsp/anytime.hpp"
+#include "tsp/one_tree.hpp"
+
+namespace tsp
+{
+    // Which lower bounds are computed for each partial path, can be or-ed together.
+    enum bnb_bound : unsigned
+    {
+        bnb_two_edges = 1u << 0,
+        bnb_reduced   = 1u << 1,
+        bnb_mst       = 1u << 2,
+        bnb_all       = bnb_two_edges | bnb_reduced | bnb_mst,
+    };
+
+    // In which order partial paths are expanded.
+    enum class bnb_order
+    {
+        depth_first, // Little memory, finds complete tours (and better upper bounds) quickly.
+        best_first,  // Always expands the path with the lowest bound, might use a lot of memory.
+    };
+
+    // Throws std::length_error for runtime instances with more than 64 nodes.
+    template<typename Mat>
+    inline auto branch_and_bound(
+        const Mat& mat,
+        const bnb_order order = bnb_order::depth_first,
+        const unsigned bounds = bnb_all
+    ) -> result<Mat>;
+
+    // Starting from the tour of start instead of approx, any tour of mat will
+    // do (like one of a similar matrix, see cache.hpp). The better it is the
+    // more gets pruned.
+    template<typename Mat>
+    inline auto branch_and_bound(
+        const Mat& mat,
+        const result<Mat>& start,
+        const bnb_order order = bnb_order::depth_first,
+        const unsigned bounds = bnb_all
+    ) -> result<Mat>;
+
+    template<typename Mat>
+    inline auto branch_and_bound(
+        const Mat& mat,
+        const budget& limits,
+        const bnb_order order = bnb_order::depth_first,
+        const unsigned bounds = bnb_all
+    ) -> anytime_result<Mat>;
+}
+
+namespace tsp::detail
+{
+    template<typename Mat>
+    struct bnb_search
+    {
+        static constexpr auto max_nodes = std::size_t{64}; // Visited sets are 64 bits wide.
+        static_assert(utils::fixed_nodes_v<Mat> <= max_nodes, "bnb visited sets are 64 bits wide");
+
+        using cicle_t = cicle<Mat>;
+        template<typename U>
+        using node_array = utils::node_array<U, Mat>;
+
+        // A partial path, path[0..depth] are valid and path[depth] is the last node.
+        struct partial
+        {
+            cicle_t path;
+            std::size_t depth;
+            std::uint64_t visited;
+            std::size_t cost;
+            std::size_t bound;
+        };
+
+        // A child of the path depth_first is on, the path itself is shared.
+        struct step
+        {
+            std::size_t next;
+            std::size_t cost;
+            std::size_t bound;
+        };
+
+        const Mat& mat;
+        const std::size_t nodes;
+        const unsigned bounds;
+
+        // The two cheapest edges (either direction) touching each node.
+        node_array<std::size_t> cheapest1;
+        node_array<std::size_t> cheapest2;
+        // Node penalties for the spanning tree bound, see optimize_penalties.
+        node_array<double> pi;
+
+        std::size_t lowest_cost;
+        cicle_t smallest_cicle;
+
+        // Only set by the anytime overload, the search stops once it says so.
+        budget_checker* limits = nullptr;
+        // share[d] is the fraction of the tours behind a path of depth d.
+        node_array<double> share;
+        double covered = 0;
+
+        // The path depth_first is on and the children of each depth (nodes
+        // slots per depth), so it doesn't allocate for every partial path.
+        cicle_t path;
+        std::vector<step> steps;
+
+        // Scratch space for the bounds, so runtime instances don't allocate for every bound.
+        mutable node_array<std::size_t> unvisited;
+        mutable utils::node_array<std::size_t, Mat, 1> row_min;
+        mutable node_array<double> key;
+        mutable node_array<char> in_mst;
+        one_tree_buffers one_tree_scratch;
+
+        bnb_search(const Mat& mat, unsigned bounds)
+            : mat{ mat }
+            , nodes{ utils::nodes(mat) }
+            , bounds{ bounds }
+            , cheapest1{ utils::make_node_array<std::size_t>(mat) }
+            , cheapest2{ utils::make_node_array<std::size_t>(mat) }
+            , pi{ utils::make_node_array<double>(mat) }
+            , smallest_cicle{ utils::make_node_array<std::size_t, 1>(mat) }
+            , share{ utils::make_node_array<double>(mat, 1.0) }
+            , unvisited{ utils::make_node_array<std::size_t>(mat) }
+            , row_min{ utils::make_node_array<std::size_t, 1>(mat) }
+            , key{ utils::make_node_array<double>(mat) }
+            , in_mst{ utils::make_node_array<char>(mat) }
+        {
+            if(nodes > max_nodes) { throw std::length_error{"branch_and_bound supports at most 64 nodes"}; }
+            for(std::size_t d = 1; d < nodes; ++d) { share[d] = share[d - 1] / static_cast<double>(nodes - d); }
+            for(std::size_t i = 0; i < nodes; ++i)
+            {
+                cheapest1[i] = cheapest2[i] = std::numeric_limits<std::size_t>::max();
+                for(std::size_t j = 0; j < nodes; ++j)
+                {
+                    if(i == j) continue;
+                    const auto c = sym_cost(i, j);
+                    if(c < cheapest1[i])      { cheapest2[i] = cheapest1[i]; cheapest1[i] = c; }
+                    else if(c < cheapest2[i]) { cheapest2[i] = c; }
+                }
+            }
+        }
+
+        // cost(from, to), following the same {to, from} convention as the other solvers.
+        auto cost(std::size_t from, std::size_t to) const -> std::size_t { return mat[{to, from}]; }
+        auto sym_cost(std::size_t a, std::size_t b) const -> std::size_t { return std::min(cost(a, b), cost(b, a)); }
+
+        auto penalized(std::size_t a, std::size_t b) const -> double { return sym_cost(a, b) + pi[a] + pi[b]; }
+
+        // Dense O(count^2) Prim over the given nodes with the penalized costs.
+        auto spanning_tree(const node_array<std::size_t>& list, std::size_t count) const -> double
+        {
+            for(std::size_t k = 0; k < count; ++k) {
+                key[k]    = std::numeric_limits<double>::max();
+                in_mst[k] = false;
+            }
+            key[0] = 0;
+
+            auto weight = 0.0;
+            for(std::size_t added = 0; added < count; ++added)
+            {
+                auto next = count;
+                for(std::size_t k = 0; k < count; ++k) {
+                    if(!in_mst[k] && (next == count || key[k] < key[next])) { next = k; }
+                }
+                in_mst[next] = true;
+                weight += key[next];
+                for(std::size_t k = 0; k < count; ++k)
+                {
+                    if(in_mst[k]) continue;
+                    const auto w = penalized(list[next], list[k]);
+                    if(w < key[k]) { key[k] = w; }
+                }
+            }
+            return weight;
+        }
+
+        // Node penalties from the Held-Karp 1-tree subgradient method (see
+        // one_tree.hpp), with the tour from approx as the upper bound.
+        // Returns the best 1-tree bound found.
+        auto optimize_penalties() -> std::size_t
+        {
+            const auto found = held_karp_bound(mat, lowest_cost, one_tree_scratch, {.iterations = 100 * nodes, .patience = nodes});
+            std::copy(found.penalties.begin(), found.penalties.end(), pi.begin());
+            return found.bound;
+        }
+
+        auto bound(const partial& p) const -> std::size_t { return bound(p.path[p.depth], p.depth, p.visited, p.cost); }
+
+        // Bound of a path of depth edges and the given cost ending on last.
+        auto bound(std::size_t last, std::size_t depth, std::uint64_t visited, std::size_t path_cost) const -> std::size_t
+        {
+            const auto left = nodes - 1 - depth;
+            if(!left) { return path_cost + cost(last, 0); }
+
+            for(std::size_t i = 1, k = 0; i < nodes; ++i) {
+                if(!(visited & (std::uint64_t{1} << i))) { unvisited[k++] = i; }
+            }
+
+            auto best = path_cost;
+
+            if(bounds & bnb_two_edges)
+            {
+                auto twice = cheapest1[last] + cheapest1[0];
+                for(std::size_t k = 0; k < left; ++k) { twice += cheapest1[unvisited[k]] + cheapest2[unvisited[k]]; }
+                best = std::max(best, path_cost + (twice + 1) / 2);
+                if(best >= lowest_cost) return best;
+            }
+
+            if(bounds & bnb_reduced)
+            {
+                // Rows: last and the unvisited nodes (need an edge out).
+                // Cols: the unvisited nodes and 0 (need an edge in).
+                // last can't go straight back to 0 since there are nodes left.
+                auto reduction = std::size_t{0};
+                const auto from = [&](std::size_t r) { return r == 0 ? last : unvisited[r - 1]; };
+                const auto to   = [&](std::size_t c) { return c == left ? std::size_t{0} : unvisited[c]; };
+                const auto allowed = [&](std::size_t r, std::size_t c) { return from(r) != to(c) && !(r == 0 && c == left); };
+
+                for(std::size_t r = 0; r <= left; ++r)
+                {
+                    row_min[r] = std::numeric_limits<std::size_t>::max();
+                    for(std::size_t c = 0; c <= left; ++c) {
+                        if(allowed(r, c)) { row_min[r] = std::min(row_min[r], cost(from(r), to(c))); }
+                    }
+                    reduction += row_min[r];
+                }
+                for(std::size_t c = 0; c <= left; ++c)
+                {
+                    auto col_min = std::numeric_limits<std::size_t>::max();
+                    for(std::size_t r = 0; r <= left; ++r) {
+                        if(allowed(r, c)) { col_min = std::min(col_min, cost(from(r), to(c)) - row_min[r]); }
+                    }
+                    reduction += col_min;
+                }
+                best = std::max(best, path_cost + reduction);
+                if(best >= lowest_cost) return best;
+            }
+
+            if(bounds & bnb_mst)
+            {
+                // The rest of the tour is an edge out of last, a path through
+                // every unvisited node (a spanning tree of them) and an edge into 0.
+                // With penalized costs every unvisited node is counted twice and
+                // last and 0 once, which we take back out at the end.
+                auto out_of_last = std::numeric_limits<double>::max();
+                auto into_0      = std::numeric_limits<double>::max();
+                auto penalties   = pi[last] + pi[0];
+                for(std::size_t k = 0; k < left; ++k)
+                {
+                    const auto u = unvisited[k];
+                    out_of_last = std::min(out_of_last, cost(last, u) + pi[last] + pi[u]);
+                    into_0      = std::min(into_0, cost(u, 0) + pi[u] + pi[0]);
+                    penalties  += 2 * pi[u];
+                }
+                const auto weight = out_of_last + spanning_tree(unvisited, left) + into_0 - penalties;
+                best = std::max(best, path_cost + as_integer_bound(weight));
+            }
+
+            return best;
+        }
+
+        // Calls out(next, cost, bound) for every child of the path of depth
+        // edges ending on at[depth] that survives the bound.
+        template<typename Out>
+        auto expand(const cicle_t& at, std::size_t depth, std::uint64_t visited, std::size_t path_cost, Out&& out) -> void
+        {
+            const auto last = at[depth];
+            for(std::size_t next = 1; next < nodes; ++next)
+            {
+                const auto next_bit = std::uint64_t{1} << next;
+                if(visited & next_bit) continue;
+
+                const auto child_cost = path_cost + cost(last, next);
+                if(child_cost >= lowest_cost) { covered += share[depth + 1]; continue; }
+
+                const auto child_bound = bound(next, depth + 1, visited | next_bit, child_cost);
+                if(child_bound >= lowest_cost) { covered += share[depth + 1]; continue; }
+
+                if(depth + 1 == nodes - 1)
+                {
+                    // A complete tour, the bound is its exact cost.
+                    lowest_cost    = child_bound;
+                    smallest_cicle = at;
+                    smallest_cicle[nodes - 1] = next;
+                    smallest_cicle[nodes]     = 0;
+                    covered += share[depth + 1];
+                    continue;
+                }
+                out(next, child_cost, child_bound);
+            }
+        }
+
+        // Whether the budget ran out, checking it every so often.
+        auto out_of_budget() -> bool
+        {
+            return limits && limits->tick(lowest_cost, [&]{ return covered; });
+        }
+
+        auto depth_first(const partial& root) -> void
+        {
+            path = root.path;
+            steps.resize(nodes * nodes);
+            depth_first(root.depth, root.visited, root.cost);
+        }
+
+        // Searches below path[0..depth].
+        auto depth_first(std::size_t depth, std::uint64_t visited, std::size_t path_cost) -> void
+        {
+            if(out_of_budget()) return;
+
+            auto* const children = steps.data() + depth * nodes;
+            auto count = std::size_t{0};
+            expand(path, depth, visited, path_cost, [&](std::size_t next, std::size_t c, std::size_t b){ children[count++] = {next, c, b}; });
+
+            // Most promising first, so good tours lower the upper bound early.
+            std::sort(children, children + count, [](const auto& a, const auto& b){ return a.bound < b.bound; });
+            for(std::size_t k = 0; k < count; ++k)
+            {
+                const auto& child = children[k];
+                if(child.bound < lowest_cost) {
+                    path[depth + 1] = child.next;
+                    depth_first(depth + 1, visited | (std::uint64_t{1} << child.next), child.cost);
+                }
+                else covered += share[depth + 1];
+            }
+        }
+
+        auto best_first(const partial& root) -> void
+        {
+            const auto cmp = [](const partial& a, const partial& b){ return a.bound > b.bound; };
+            auto open = std::priority_queue<partial, std::vector<partial>, decltype(cmp)>{cmp};
+            open.push(root);
+            while(!open.empty() && !out_of_budget())
+            {
+                const auto p = open.top();
+                open.pop();
+                // Everything left is at least as bad.
+                if(p.bound >= lowest_cost) { covered = 1; break; }
+                // Every open path needs its own copy, unlike depth_first.
+                expand(p.path, p.depth, p.visited, p.cost, [&](std::size_t next, std::size_t c, std::size_t b) {
+                    auto child = p;
+                    child.path[++child.depth] = next;
+                    child.visited |= std::uint64_t{1} << next;
+                    child.cost     = c;
+                    child.bound    = b;
+                    open.push(std::move(child));
+                });
+            }
+        }
+
+        // Starts from the tour of start (or of approx) and returns the root path, with
+        // the best bound we can get for it. There's nothing to search when it isn't below lowest_cost.
+        auto prepare(const result<Mat>* start = nullptr) -> partial
+        {
+            std::tie(lowest_cost, smallest_cicle) = start ? *start : approx(mat);
+
+            auto root = partial{};
+            root.path    = utils::make_node_array<std::size_t, 1>(mat);
+            root.depth   = 0;
+            root.visited = 1;
+            root.cost    = 0;
+            // With less than 2 nodes the tour of approx is the only one.
+            if(nodes < 2) { root.bound = lowest_cost; return root; }
+            root.bound   = bound(root);
+
+            // For symmetric matrices any tour minus one edge is a spanning tree, so the MST weight is a bound.
+            if(utils::is_symmetric(mat))
+            {
+                root.bound = std::max(root.bound, mst_weight(mat, prims(mat)));
+            }
+
+            if(bounds & bnb_mst) {
+                if(nodes >= 3) root.bound = std::max(root.bound, optimize_penalties());
+                root.bound = std::max(root.bound, bound(root));
+            }
+            return root;
+        }
+
+        auto run(const partial& root, bnb_order order) -> void
+        {
+            if(root.bound >= lowest_cost) { covered = 1; return; }
+
+            switch(order)
+            {
+                case bnb_order::depth_first: depth_first(root); break;
+                case bnb_order::best_first:  best_first(root);  break;
+            }
+        }
+    };
+}
+
+template<typename Mat>
+inline auto tsp::branch_and_bound(
+    const Mat& mat,
+    const bnb_order order,
+    const unsigned bounds
+) -> result<Mat>
+{
+    auto search = detail::bnb_search<Mat>{mat, bounds};
+    search.run(search.prepare(), order);
+    return {search.lowest_cost, search.smallest_cicle};
+}
+
+template<typename Mat>
+inline auto tsp::branch_and_bound(
+    const Mat& mat,
+    const result<Mat>& start,
+    const bnb_order order,
+    const unsigned bounds
+) -> result<Mat>
+{
+    auto search = detail::bnb_search<Mat>{mat, bounds};
+    search.run(search.prepare(&start), order);
+    return {search.lowest_cost, search.smallest_cicle};
+}
+
+template<typename Mat>
+inline auto tsp::branch_and_bound(
+    const Mat& mat,
+    const budget& limits,
+    const bnb_order order,
+    const unsigned bounds
+) -> anytime_result<Mat>
+{
+    // Every partial path does O(nodes^2) work for its bounds, so the clock can be checked often.
+    auto checker = detail::budget_checker{limits, 64};
+    auto search  = detail::bnb_search<Mat>{mat, bounds};
+    search.limits = &checker;
+    search.run(search.prepare(), order);
+
+    const auto optimal = !checker.stopped();
+    const auto covered = optimal ? 1.0 : std::min(1.0, search.covered);
+    checker.finish(search.lowest_cost, covered);
+    return {search.lowest_cost, search.smallest_cicle, optimal, covered};
+}
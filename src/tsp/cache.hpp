@@ -0,0 +1,465 @@
+/// Contains a cache of solved instances, keyed by a fingerprint of their matrix.
+//
+// The same matrix always has the same optimal tour, so when the same
+// instances keep coming back a solution_cache remembers their answers:
+//
+//     auto cache = tsp::solution_cache{};
+//     const auto [cost, tour] = cache.solve(mat, [](const auto& m, const auto& start) {
+//         return start ? tsp::branch_and_bound(m, *start) : tsp::branch_and_bound(m);
+//     });
+//
+// The key is a fingerprint of the matrix: every row is hashed on its own and
+// the row hashes are mixed into one 64 bit hash, O(n^2) multiplications, far
+// less than any solver. A hit must have the same row hashes and its tour must
+// sum to its cost on the matrix, so a collision costs a miss, never a wrong
+// answer (short of every row colliding at once).
+//
+// Every entry says whether its tour is optimal. solve(mat, solver, exact)
+// with exact = false takes any entry as a hit, with exact = true (the
+// default) only optimal ones: a heuristic tour of the same matrix is only
+// its start.
+//
+// When a matrix isn't in the cache but one of the same size that differs in
+// at most max_changed_rows rows is (a few costs were updated), the tour of
+// that one is summed on the new matrix and given to the solver as start: any
+// tour is an upper bound, and one from an almost identical matrix tends to be
+// optimal or close to it, so the exact solvers prune from the very beginning.
+// Solvers taking only the matrix are called without it, and if the solver
+// returns something worse than start, start is kept.
+//
+// The entries live in an LRU list of `capacity` entries. With a path they are
+// also appended to a file, which is memory mapped and looked at before
+// solving, so they outlive the process. The file is a log of records:
+//
+//     "TSPCACHE" version
+//     hash cost nodes exact | row hashes (8 bytes each) | tour ((nodes + 1) * 4 bytes) | padding to 8 bytes
+//     hash cost nodes exact | ...
+//
+// A record that was only partly written (the process died) is ignored, and
+// the next one overwrites it. Near matches are only searched in memory.
+//
+// Every method takes a lock, so a cache can be shared by many threads (like
+// the workers of a batch_solver), but solvers run without holding it.
+#pragma once
+
+#include <type_traits> // For std::is_invocable_v.
+#include <unordered_map>
+#include <stdexcept> // For std::runtime_error.
+#include <algorithm> // For std::min.
+#include <optional>
+#include <cstdint> // For the fixed width integers.
+#include <cstddef> // For std::size_t.
+#include <cstring> // For std::memcpy.
+#include <string>
+#include <vector>
+#include <mutex>
+#include <list>
+#include <bit> // For std::bit_cast.
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define TSP_CACHE_MMAP 1
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#else
+    #define TSP_CACHE_MMAP 0
+#endif
+
+#include "utils.hpp"
+#include "tsp/result.hpp"
+
+namespace tsp
+{
+    struct cache_error : std::runtime_error { using std::runtime_error::runtime_error; };
+
+    struct matrix_fingerprint
+    {
+        std::uint64_t hash;
+        std::vector<std::uint64_t> rows; // Hash of every row.
+    };
+
+    template<typename Mat>
+    inline auto fingerprint(const Mat& mat) -> matrix_fingerprint;
+
+    struct cache_options
+    {
+        std::size_t capacity = 1024;     // Entries kept in memory.
+        std::optional<std::string> path = {}; // Of the file to keep them in too.
+        std::size_t max_changed_rows = 2; // For a near match, 0 turns them off (but not a heuristic tour of the same matrix).
+    };
+
+    struct cache_stats
+    {
+        std::size_t hits        = 0;
+        std::size_t warm_starts = 0; // Misses that found a near match.
+        std::size_t misses      = 0;
+    };
+
+    // A tour as the cache keeps it.
+    struct cache_entry
+    {
+        std::uint64_t hash;
+        std::size_t cost;
+        bool exact; // The tour is optimal.
+        std::vector<std::uint64_t> rows;
+        std::vector<std::uint32_t> tour;
+    };
+}
+
+namespace tsp::detail
+{
+    // A multiply and a xor-shift per value, good enough to tell matrices apart.
+    constexpr auto hash_mix(std::uint64_t h, std::uint64_t value) -> std::uint64_t
+    {
+        h = (h ^ value) * 0x9E3779B97F4A7C15ull;
+        return h ^ (h >> 32);
+    }
+
+    template<typename T>
+    constexpr auto hash_bits(T value) -> std::uint64_t
+    {
+        if constexpr(std::is_floating_point_v<T>) { return std::bit_cast<std::uint64_t>(static_cast<double>(value)); }
+        else                                      { return static_cast<std::uint64_t>(value); }
+    }
+
+    // The records of the file, see the top of the file.
+    class mapped_store
+    {
+    public:
+        explicit mapped_store(const std::string& path);
+        ~mapped_store();
+        mapped_store(const mapped_store&) = delete;
+        auto operator=(const mapped_store&) -> mapped_store& = delete;
+
+        auto find(std::uint64_t hash) const -> std::optional<cache_entry>;
+        auto append(const cache_entry& entry) -> void;
+
+    private:
+        static constexpr char magic[8] = {'T', 'S', 'P', 'C', 'A', 'C', 'H', 'E'};
+        static constexpr auto version     = std::uint64_t{2};
+        static constexpr auto header_size = sizeof(magic) + sizeof(version);
+        static constexpr auto fixed_size  = 4 * sizeof(std::uint64_t); // hash, cost, nodes and exact.
+
+        static auto record_size(std::size_t nodes) -> std::size_t
+        {
+            const auto size = fixed_size + nodes * sizeof(std::uint64_t) + (nodes + 1) * sizeof(std::uint32_t);
+            return (size + 7) / 8 * 8;
+        }
+        auto read_u64(std::size_t offset) const -> std::uint64_t
+        {
+            auto value = std::uint64_t{0};
+            std::memcpy(&value, data + offset, sizeof(value));
+            return value;
+        }
+        auto remap(std::size_t size) -> void;
+
+        int fd = -1;
+        const unsigned char* data = nullptr;
+        std::size_t mapped = 0; // Bytes mapped, the whole file.
+        std::size_t end    = 0; // Past the last complete record.
+        std::unordered_map<std::uint64_t, std::size_t> offsets; // Hash to record, the last one wins.
+    };
+}
+
+namespace tsp
+{
+    class solution_cache
+    {
+    public:
+        // Throws cache_error when the file can't be used.
+        explicit solution_cache(const cache_options& options = {})
+            : options{options}
+        {
+            if(options.path) store.emplace(*options.path);
+        }
+
+        // The cached answer for mat, if there's one (an optimal one unless exact is false).
+        template<typename Mat>
+        auto find(const Mat& mat, bool exact = true) -> std::optional<result<Mat>>
+        {
+            const auto print = fingerprint(mat);
+            auto guard = std::scoped_lock{lock};
+            return lookup(mat, print, exact);
+        }
+
+        // The tour of the closest cached matrix of the same size (see the top of the file), summed on mat.
+        template<typename Mat>
+        auto warm_start(const Mat& mat) -> std::optional<result<Mat>>
+        {
+            const auto print = fingerprint(mat);
+            auto guard = std::scoped_lock{lock};
+            return nearest(mat, print);
+        }
+
+        // exact tells whether answer is optimal.
+        template<typename Mat>
+        auto insert(const Mat& mat, const result<Mat>& answer, bool exact = true) -> void
+        {
+            auto print = fingerprint(mat);
+            auto guard = std::scoped_lock{lock};
+            remember(make_entry<Mat>(std::move(print), answer, exact), true);
+        }
+
+        // The cached answer, or solve(mat, start) (or solve(mat)) which is cached for next time.
+        // start is a std::optional<result<Mat>> with the near match, if any. exact
+        // tells whether solve is an exact solver, see the top of the file.
+        template<typename Mat, typename Solve>
+        auto solve(const Mat& mat, Solve&& solve, bool exact = true) -> result<Mat>;
+
+        auto stats() const -> cache_stats { auto guard = std::scoped_lock{lock}; return counts; }
+        auto size() const -> std::size_t { auto guard = std::scoped_lock{lock}; return by_hash.size(); }
+
+    private:
+        using entries = std::list<cache_entry>;
+
+        template<typename Mat>
+        static auto tour_cost(const Mat& mat, const std::vector<std::uint32_t>& tour) -> std::optional<std::size_t>
+        {
+            const auto nodes = utils::nodes(mat);
+            if(tour.size() != nodes + 1) return std::nullopt;
+            auto cost = std::size_t{0};
+            for(std::size_t i = 0; i < tour.size(); ++i) {
+                if(tour[i] >= nodes) return std::nullopt;
+                if(i) cost += mat[{tour[i], tour[i - 1]}];
+            }
+            return cost;
+        }
+
+        template<typename Mat>
+        static auto as_result(const Mat& mat, std::size_t cost, const std::vector<std::uint32_t>& tour) -> result<Mat>
+        {
+            auto cicle = utils::make_node_array<std::size_t, 1>(mat);
+            for(std::size_t i = 0; i < tour.size(); ++i) { cicle[i] = tour[i]; }
+            return {cost, cicle};
+        }
+
+        template<typename Mat>
+        static auto make_entry(matrix_fingerprint&& print, const result<Mat>& answer, bool exact) -> cache_entry
+        {
+            const auto& [cost, cicle] = answer;
+            auto entry = cache_entry{print.hash, cost, exact, std::move(print.rows), {}};
+            entry.tour.assign(cicle.begin(), cicle.end());
+            return entry;
+        }
+
+        // Moves the entry to the front, or adds it there (evicting the last one when full).
+        // An optimal tour of the same matrix isn't replaced by a heuristic one.
+        auto remember(cache_entry&& entry, bool persist) -> void
+        {
+            const auto found = by_hash.find(entry.hash);
+            const auto keep = found != by_hash.end() && found->second->exact && !entry.exact && found->second->rows == entry.rows;
+            if(persist && store && !keep) store->append(entry);
+            if(found != by_hash.end()) {
+                if(!keep) *found->second = std::move(entry);
+                recent.splice(recent.begin(), recent, found->second);
+                return;
+            }
+            if(!options.capacity) return;
+            if(by_hash.size() == options.capacity) {
+                by_hash.erase(recent.back().hash);
+                recent.pop_back();
+            }
+            recent.push_front(std::move(entry));
+            by_hash.emplace(recent.front().hash, recent.begin());
+        }
+
+        template<typename Mat>
+        static auto same_matrix(const Mat& mat, const matrix_fingerprint& print, const cache_entry& entry) -> bool
+        {
+            return entry.rows == print.rows && tour_cost(mat, entry.tour) == entry.cost; // Or a collision.
+        }
+
+        // An entry of the same matrix found in the file is kept in memory even
+        // when it isn't exact enough, so nearest() can start from it.
+        template<typename Mat>
+        auto lookup(const Mat& mat, const matrix_fingerprint& print, bool exact) -> std::optional<result<Mat>>
+        {
+            if(const auto found = by_hash.find(print.hash); found != by_hash.end())
+            {
+                const auto& entry = *found->second;
+                if(!same_matrix(mat, print, entry)) return std::nullopt;
+                recent.splice(recent.begin(), recent, found->second);
+                if(exact && !entry.exact) return std::nullopt;
+                return as_result(mat, entry.cost, entry.tour);
+            }
+            if(!store) return std::nullopt;
+
+            auto entry = store->find(print.hash);
+            if(!entry || !same_matrix(mat, print, *entry)) return std::nullopt;
+            auto answer = as_result(mat, entry->cost, entry->tour);
+            const auto usable = !exact || entry->exact;
+            remember(std::move(*entry), false);
+            if(!usable) return std::nullopt;
+            return answer;
+        }
+
+        template<typename Mat>
+        auto nearest(const Mat& mat, const matrix_fingerprint& print) const -> std::optional<result<Mat>>
+        {
+            const entries::value_type* closest = nullptr;
+            auto fewest = options.max_changed_rows + 1;
+            for(const auto& entry : recent)
+            {
+                if(entry.rows.size() != print.rows.size()) continue;
+                auto changed = std::size_t{0};
+                for(std::size_t r = 0; r < entry.rows.size() && changed < fewest; ++r) { changed += entry.rows[r] != print.rows[r]; }
+                // The most recent one wins ties.
+                if(changed < fewest) { fewest = changed; closest = &entry; }
+            }
+            if(!closest) return std::nullopt;
+
+            const auto cost = tour_cost(mat, closest->tour);
+            if(!cost) return std::nullopt;
+            return as_result(mat, *cost, closest->tour);
+        }
+
+        cache_options options;
+        mutable std::mutex lock;
+        entries recent; // Most recently used first.
+        std::unordered_map<std::uint64_t, entries::iterator> by_hash;
+        std::optional<detail::mapped_store> store;
+        cache_stats counts;
+    };
+}
+
+template<typename Mat>
+inline auto tsp::fingerprint(const Mat& mat) -> matrix_fingerprint
+{
+    const auto nodes = utils::nodes(mat);
+    auto print = matrix_fingerprint{detail::hash_mix(0, nodes), std::vector<std::uint64_t>(nodes)};
+    for(std::size_t y = 0; y < nodes; ++y)
+    {
+        auto h = detail::hash_mix(0, y);
+        for(std::size_t x = 0; x < nodes; ++x) { h = detail::hash_mix(h, detail::hash_bits(mat[{x, y}])); }
+        print.rows[y] = h;
+        print.hash    = detail::hash_mix(print.hash, h);
+    }
+    return print;
+}
+
+template<typename Mat, typename Solve>
+inline auto tsp::solution_cache::solve(const Mat& mat, Solve&& solve, bool exact) -> result<Mat>
+{
+    auto print = fingerprint(mat);
+    auto start = std::optional<result<Mat>>{};
+    {
+        auto guard = std::scoped_lock{lock};
+        if(auto hit = lookup(mat, print, exact)) { ++counts.hits; return *hit; }
+        // Also finds a heuristic tour of this same matrix, 0 rows away.
+        start = nearest(mat, print);
+        ++(start ? counts.warm_starts : counts.misses);
+    }
+
+    auto answer = [&]{
+        if constexpr(std::is_invocable_v<Solve, const Mat&, const std::optional<result<Mat>>&>) { return solve(mat, start); }
+        else                                                                                     { return solve(mat); }
+    }();
+    if(start && std::get<0>(*start) < std::get<0>(answer)) answer = *start;
+
+    auto guard = std::scoped_lock{lock};
+    remember(make_entry<Mat>(std::move(print), answer, exact), true);
+    return answer;
+}
+
+inline tsp::detail::mapped_store::mapped_store(const std::string& path)
+{
+#if TSP_CACHE_MMAP
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd < 0) throw cache_error{"can't open the cache file " + path};
+
+    struct stat info{};
+    if(::fstat(fd, &info) != 0) { ::close(fd); throw cache_error{"can't stat the cache file " + path}; }
+    auto size = static_cast<std::size_t>(info.st_size);
+    if(size == 0)
+    {
+        unsigned char header[header_size];
+        std::memcpy(header, magic, sizeof(magic));
+        std::memcpy(header + sizeof(magic), &version, sizeof(version));
+        if(::pwrite(fd, header, header_size, 0) != static_cast<ssize_t>(header_size)) { ::close(fd); throw cache_error{"can't write to the cache file " + path}; }
+        size = header_size;
+    }
+    remap(size);
+    if(size < header_size || std::memcmp(data, magic, sizeof(magic)) != 0 || read_u64(sizeof(magic)) != version) {
+        if(data) ::munmap(const_cast<unsigned char*>(data), mapped);
+        ::close(fd);
+        throw cache_error{path + " is not a cache file (of this version)"};
+    }
+
+    // Index every complete record.
+    end = header_size;
+    while(end + fixed_size <= mapped)
+    {
+        const auto nodes = read_u64(end + 2 * sizeof(std::uint64_t));
+        if(nodes > mapped || end + record_size(nodes) > mapped) break;
+        offsets[read_u64(end)] = end;
+        end += record_size(nodes);
+    }
+#else
+    (void)path;
+    throw cache_error{"the cache file needs mmap, which this platform doesn't have"};
+#endif
+}
+
+inline tsp::detail::mapped_store::~mapped_store()
+{
+#if TSP_CACHE_MMAP
+    if(data) ::munmap(const_cast<unsigned char*>(data), mapped);
+    if(fd >= 0) ::close(fd);
+#endif
+}
+
+inline auto tsp::detail::mapped_store::remap(std::size_t size) -> void
+{
+#if TSP_CACHE_MMAP
+    if(data) ::munmap(const_cast<unsigned char*>(data), mapped);
+    data   = nullptr;
+    mapped = 0;
+    if(!size) return;
+    auto* const address = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if(address == MAP_FAILED) throw cache_error{"can't map the cache file"};
+    data   = static_cast<const unsigned char*>(address);
+    mapped = size;
+#else
+    (void)size;
+#endif
+}
+
+inline auto tsp::detail::mapped_store::find(std::uint64_t hash) const -> std::optional<cache_entry>
+{
+    const auto found = offsets.find(hash);
+    if(found == offsets.end()) return std::nullopt;
+
+    auto offset = found->second;
+    const auto nodes = static_cast<std::size_t>(read_u64(offset + 2 * sizeof(std::uint64_t)));
+    auto entry = cache_entry{
+        hash, static_cast<std::size_t>(read_u64(offset + sizeof(std::uint64_t))), read_u64(offset + 3 * sizeof(std::uint64_t)) != 0,
+        std::vector<std::uint64_t>(nodes), std::vector<std::uint32_t>(nodes + 1)
+    };
+    offset += fixed_size;
+    std::memcpy(entry.rows.data(), data + offset, nodes * sizeof(std::uint64_t));
+    offset += nodes * sizeof(std::uint64_t);
+    std::memcpy(entry.tour.data(), data + offset, (nodes + 1) * sizeof(std::uint32_t));
+    return entry;
+}
+
+inline auto tsp::detail::mapped_store::append(const cache_entry& entry) -> void
+{
+#if TSP_CACHE_MMAP
+    const auto nodes = entry.rows.size();
+    auto record = std::vector<unsigned char>(record_size(nodes), 0);
+    const std::uint64_t fixed[] = {entry.hash, entry.cost, nodes, entry.exact};
+    std::memcpy(record.data(), fixed, fixed_size);
+    std::memcpy(record.data() + fixed_size, entry.rows.data(), nodes * sizeof(std::uint64_t));
+    std::memcpy(record.data() + fixed_size + nodes * sizeof(std::uint64_t), entry.tour.data(), entry.tour.size() * sizeof(std::uint32_t));
+
+    if(::pwrite(fd, record.data(), record.size(), static_cast<off_t>(end)) != static_cast<ssize_t>(record.size())) {
+        throw cache_error{"can't write to the cache file"};
+    }
+    offsets[entry.hash] = end;
+    end += record.size();
+    remap(end);
+#else
+    (void)entry;
+#endif
+}
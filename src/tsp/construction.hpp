@@ -0,0 +1,392 @@
+/// Contains construction heuristics, more ways than tsp::approx to build a first tour.
+//
+// All of them return the same result tuple as the solvers, a cycle from node 0
+// back to it, in O(n^2) time over flat arrays or better unless noted:
+//
+// - nearest_neighbor: from node 0 always go to the closest node not visited
+//   yet. About 25% above the optimum on random points.
+// - greedy_edge: take edges from the cheapest up, skipping the ones that
+//   would give a node degree 3 or close a cycle too early. Only the k nearest
+//   neighbours of each node are looked at (sorting all n^2 edges would cost
+//   O(n^2 log n)), and the fragments left over are joined nearest neighbour
+//   style from end to end. About 15-20% above the optimum.
+// - christofides: the MST plus a perfect matching of its odd degree nodes
+//   has every degree even, so it has an Euler tour, which is shortcut into a
+//   tour. With the exact matching (O(n^3), see matching.hpp) it is at most 1.5
+//   times the optimum on metric costs, with the greedy one (O(n^2) time and
+//   O(n * k) memory) it is usually a bit worse but much faster.
+// - space_filling_curve: for instances with coordinates, visits the nodes in
+//   the order of a Hilbert curve through the plane. O(n log n), and only looks
+//   at the matrix for the cost, but 25% or more above the optimum.
+//
+// greedy_edge and christofides work on undirected edges, with
+// min(cost(a, b), cost(b, a)) for asymmetric matrices, and go around the tour
+// in the cheaper direction. approx(mat, mode) picks one of them (or the
+// double tree of approx.hpp), and bench_solvers times them and their gap.
+// Except for christofides with the exact matching, which keeps all m^2 edges
+// between the m odd nodes, none of them keep more than O(n * k) data, so they
+// also run on the compact providers of distances.hpp.
+#pragma once
+
+#include <algorithm> // For std::sort, std::nth_element, std::min and std::max.
+#include <cstdint> // For std::uint32_t and std::uint64_t.
+#include <cstddef> // For std::size_t.
+#include <limits> // For std::numeric_limits.
+#include <numeric> // For std::iota.
+#include <vector>
+#include <array>
+
+#include "utils.hpp"
+#include "tsp/result.hpp"
+#include "tsp/approx.hpp"
+#include "tsp/matching.hpp"
+#include "tsp/instrument.hpp"
+
+namespace tsp
+{
+    template<typename Mat>
+    inline auto nearest_neighbor(const Mat& mat) -> result<Mat>;
+
+    // k is the amount of candidate neighbours of each node.
+    template<typename Mat>
+    inline auto greedy_edge(const Mat& mat, std::size_t k = 10) -> result<Mat>;
+
+    template<typename Mat>
+    inline auto christofides(const Mat& mat, matching_method matching = matching_method::greedy) -> result<Mat>;
+
+    // coords[i] is where node i is, like tsplib::instance::coords.
+    template<typename Mat>
+    inline auto space_filling_curve(const Mat& mat, const std::vector<std::array<double, 2>>& coords) -> result<Mat>;
+
+    enum class approx_mode
+    {
+        double_tree, // tsp::approx, the MST walked in preorder.
+        nearest_neighbor,
+        greedy_edge,
+        christofides,       // With the greedy matching.
+        christofides_exact, // With the blossom matching.
+    };
+
+    template<typename Mat>
+    inline auto approx(const Mat& mat, approx_mode mode) -> result<Mat>
+    {
+        switch(mode)
+        {
+            case approx_mode::nearest_neighbor:   return nearest_neighbor(mat);
+            case approx_mode::greedy_edge:        return greedy_edge(mat);
+            case approx_mode::christofides:       return christofides(mat, matching_method::greedy);
+            case approx_mode::christofides_exact: return christofides(mat, matching_method::exact);
+            default:                              return approx(mat);
+        }
+    }
+}
+
+namespace tsp::detail
+{
+    // cost(a, b) of an undirected edge.
+    template<typename Mat>
+    inline auto edge_cost(const Mat& mat, std::size_t a, std::size_t b) -> std::size_t
+    {
+        return static_cast<std::size_t>(std::min(mat[{a, b}], mat[{b, a}]));
+    }
+
+    // Turns an order of every node into a result: rotated to start at 0, closed, and summed.
+    template<typename Mat>
+    inline auto as_tour(const Mat& mat, const std::vector<std::size_t>& order) -> result<Mat>
+    {
+        const auto nodes = order.size();
+        auto cicle = utils::make_node_array<std::size_t, 1>(mat);
+        if(!nodes) return {0, cicle};
+        const auto zero = static_cast<std::size_t>(std::find(order.begin(), order.end(), std::size_t{0}) - order.begin());
+        for(std::size_t i = 0; i < nodes; ++i) { cicle[i] = order[(zero + i) % nodes]; }
+        cicle[nodes] = 0;
+
+        auto cost = std::size_t{0};
+        for(std::size_t i = 1; i <= nodes; ++i) { cost += mat[{cicle[i], cicle[i - 1]}]; }
+        return {cost, cicle};
+    }
+
+    // Same, for a cycle of undirected edges: going around it whichever way is cheaper.
+    template<typename Mat>
+    inline auto as_tour_either_way(const Mat& mat, std::vector<std::size_t> order) -> result<Mat>
+    {
+        auto forward = as_tour(mat, order);
+        std::reverse(order.begin(), order.end());
+        auto backward = as_tour(mat, order);
+        return std::get<0>(backward) < std::get<0>(forward) ? backward : forward;
+    }
+}
+
+template<typename Mat>
+inline auto tsp::nearest_neighbor(const Mat& mat) -> result<Mat>
+{
+    using T = typename Mat::value_type;
+    const auto nodes = utils::nodes(mat);
+    auto stats = instrument::recorder{"nearest_neighbor"};
+
+    auto order   = std::vector<std::size_t>{};
+    auto visited = std::vector<char>(nodes, false);
+    order.reserve(nodes);
+    for(auto current = std::size_t{0}; order.size() < nodes;)
+    {
+        order.push_back(current);
+        visited[current] = true;
+
+        auto next = nodes;
+        auto best = std::numeric_limits<T>::max();
+        for(std::size_t to = 0; to < nodes; ++to)
+        {
+            if(visited[to]) continue;
+            const auto c = mat[{to, current}];
+            if(next == nodes || c < best) { best = c; next = to; }
+        }
+        stats.add(0, instrument::lookups, nodes);
+        current = next;
+    }
+    stats.add(0, instrument::expanded, nodes);
+    stats.publish();
+    return detail::as_tour(mat, order);
+}
+
+template<typename Mat>
+inline auto tsp::greedy_edge(const Mat& mat, std::size_t k) -> result<Mat>
+{
+    const auto nodes = utils::nodes(mat);
+    if(nodes < 3) return nearest_neighbor(mat);
+    k = std::max<std::size_t>(1, std::min(k, nodes - 1));
+    auto stats = instrument::recorder{"greedy_edge"};
+
+    // The candidate edges, each pair once, cheapest first.
+    struct edge { std::size_t cost, a, b; };
+    auto edges = std::vector<edge>{};
+    edges.reserve(nodes * k);
+    {
+        auto others = std::vector<std::size_t>(nodes - 1);
+        auto costs  = std::vector<std::size_t>(nodes); // Of the edges of a, each looked up once.
+        for(std::size_t a = 0; a < nodes; ++a)
+        {
+            for(std::size_t b = 0, i = 0; b < nodes; ++b)
+            {
+                costs[b] = detail::edge_cost(mat, a, b);
+                if(b != a) others[i++] = b;
+            }
+            const auto by_cost = [&](std::size_t x, std::size_t y) { return costs[x] < costs[y] || (costs[x] == costs[y] && x < y); };
+            std::nth_element(others.begin(), others.begin() + (k - 1), others.end(), by_cost);
+            for(std::size_t i = 0; i < k; ++i)
+            {
+                // a is also among the k nearest of others[i] most of the time, so both directions only go in once.
+                const auto b = others[i];
+                edges.push_back({costs[b], std::min(a, b), std::max(a, b)});
+            }
+        }
+        std::sort(edges.begin(), edges.end(), [](const edge& l, const edge& r) {
+            return l.cost < r.cost || (l.cost == r.cost && (l.a < r.a || (l.a == r.a && l.b < r.b)));
+        });
+        edges.erase(std::unique(edges.begin(), edges.end(), [](const edge& l, const edge& r) { return l.a == r.a && l.b == r.b; }), edges.end());
+        stats.add(0, instrument::lookups, 2 * nodes * nodes);
+    }
+
+    // Every node has up to two neighbours, and a union find over the fragments keeps them paths.
+    constexpr auto none = std::numeric_limits<std::size_t>::max();
+    auto links    = std::vector<std::array<std::size_t, 2>>(nodes, {none, none});
+    auto degree   = std::vector<std::size_t>(nodes, 0);
+    auto fragment = std::vector<std::size_t>(nodes);
+    std::iota(fragment.begin(), fragment.end(), std::size_t{0});
+    const auto find = [&](std::size_t v) {
+        while(fragment[v] != v) { fragment[v] = fragment[fragment[v]]; v = fragment[v]; }
+        return v;
+    };
+    const auto link = [&](std::size_t a, std::size_t b) {
+        links[a][degree[a]++] = b;
+        links[b][degree[b]++] = a;
+    };
+
+    auto added = std::size_t{0};
+    for(const auto& [cost, a, b] : edges)
+    {
+        if(added == nodes - 1) break;
+        if(degree[a] == 2 || degree[b] == 2) continue;
+        const auto fa = find(a);
+        const auto fb = find(b);
+        if(fa == fb) continue;
+        fragment[fa] = fb;
+        link(a, b);
+        ++added;
+    }
+
+    // Join the fragments, from the far end of each one to the closest free end of another.
+    auto ends  = std::vector<std::size_t>{};     // Nodes with degree < 2.
+    auto other = std::vector<std::size_t>(nodes); // The far end of the fragment of each end.
+    for(std::size_t v = 0; v < nodes; ++v)
+    {
+        if(degree[v] == 2) continue;
+        ends.push_back(v);
+        if(degree[v] == 0) { other[v] = v; continue; }
+        auto prev = v;
+        auto at   = links[v][0];
+        while(degree[at] == 2) {
+            const auto next = links[at][0] == prev ? links[at][1] : links[at][0];
+            prev = at;
+            at   = next;
+        }
+        other[v] = at;
+    }
+    auto joined = std::vector<char>(nodes, false); // By end.
+    const auto first = ends.front();
+    auto tail = other[first];
+    joined[first] = joined[tail] = true;
+    for(auto left = ends.size() - (first == tail ? 1 : 2); left;)
+    {
+        auto next = none;
+        for(const auto e : ends) {
+            if(!joined[e] && (next == none || detail::edge_cost(mat, tail, e) < detail::edge_cost(mat, tail, next))) next = e;
+        }
+        stats.add(0, instrument::lookups, ends.size());
+        link(tail, next);
+        joined[next] = joined[other[next]] = true;
+        left -= next == other[next] ? 1 : 2;
+        tail = other[next];
+    }
+    link(tail, first);
+
+    // Walk the cycle.
+    auto order = std::vector<std::size_t>{};
+    order.reserve(nodes);
+    for(std::size_t prev = links[0][1], at = 0; order.size() < nodes;)
+    {
+        order.push_back(at);
+        const auto next = links[at][0] == prev ? links[at][1] : links[at][0];
+        prev = at;
+        at   = next;
+    }
+    stats.add(0, instrument::expanded, nodes);
+    stats.publish();
+    return detail::as_tour_either_way(mat, std::move(order));
+}
+
+template<typename Mat>
+inline auto tsp::christofides(const Mat& mat, matching_method matching) -> result<Mat>
+{
+    const auto nodes = utils::nodes(mat);
+    if(nodes < 3) return nearest_neighbor(mat);
+    auto stats = instrument::recorder{"christofides"};
+
+    // The MST over the undirected costs, its edges are (v, parent[v]).
+    auto parent = std::vector<std::size_t>(nodes, 0);
+    {
+        // Like prims, the biggest key marks the tree for argmin but membership is kept apart.
+        constexpr auto in_tree = std::numeric_limits<std::size_t>::max();
+        auto key = std::vector<std::size_t>(nodes, in_tree);
+        auto added_to_tree = std::vector<char>(nodes, false);
+        added_to_tree[0] = true;
+        for(std::size_t i = 1; i < nodes; ++i) { key[i] = detail::edge_cost(mat, 0, i); }
+        for(std::size_t step = 1; step < nodes; ++step)
+        {
+            auto added = utils::argmin(key.data(), nodes);
+            if(added_to_tree[added]) { added = 0; while(added_to_tree[added]) ++added; }
+            key[added] = in_tree;
+            added_to_tree[added] = true;
+            for(std::size_t i = 0; i < nodes; ++i)
+            {
+                if(added_to_tree[i]) continue;
+                const auto w = detail::edge_cost(mat, added, i);
+                if(w < key[i]) { key[i] = w; parent[i] = added; }
+            }
+        }
+        stats.add(0, instrument::lookups, 2 * nodes * nodes);
+    }
+
+    // Plus a perfect matching of the nodes with odd degree (there's always an even amount of them).
+    auto degree = std::vector<std::size_t>(nodes, 0);
+    for(std::size_t v = 1; v < nodes; ++v) { ++degree[v]; ++degree[parent[v]]; }
+    auto odd = std::vector<std::size_t>{};
+    for(std::size_t v = 0; v < nodes; ++v) { if(degree[v] % 2) odd.push_back(v); }
+    const auto mate = min_weight_perfect_matching(
+        odd.size(),
+        [&](std::size_t a, std::size_t b) { return detail::edge_cost(mat, odd[a], odd[b]); },
+        matching
+    );
+
+    // The multigraph in CSR form (every edge in both directions, with the same id).
+    auto from = std::vector<std::size_t>{};
+    auto to   = std::vector<std::size_t>{};
+    for(std::size_t v = 1; v < nodes; ++v) { from.push_back(v); to.push_back(parent[v]); }
+    for(std::size_t i = 0; i < odd.size(); ++i) {
+        if(i < mate[i]) { from.push_back(odd[i]); to.push_back(odd[mate[i]]); }
+    }
+    auto offsets = std::vector<std::size_t>(nodes + 1, 0);
+    for(std::size_t e = 0; e < from.size(); ++e) { ++offsets[from[e] + 1]; ++offsets[to[e] + 1]; }
+    for(std::size_t v = 0; v < nodes; ++v) { offsets[v + 1] += offsets[v]; }
+    auto incident = std::vector<std::size_t>(2 * from.size()); // Edge ids.
+    {
+        auto cursor = std::vector<std::size_t>(offsets.begin(), offsets.end() - 1);
+        for(std::size_t e = 0; e < from.size(); ++e) { incident[cursor[from[e]]++] = e; incident[cursor[to[e]]++] = e; }
+    }
+
+    // Hierholzer's Euler tour with an explicit stack, shortcut on the fly:
+    // nodes are kept the first time they come off the stack.
+    auto used    = std::vector<char>(from.size(), false);
+    auto next    = std::vector<std::size_t>(offsets.begin(), offsets.end() - 1); // Next incident edge to try.
+    auto visited = std::vector<char>(nodes, false);
+    auto order   = std::vector<std::size_t>{};
+    auto stack   = std::vector<std::size_t>{0};
+    order.reserve(nodes);
+    while(!stack.empty())
+    {
+        const auto v = stack.back();
+        while(next[v] < offsets[v + 1] && used[incident[next[v]]]) ++next[v];
+        if(next[v] == offsets[v + 1])
+        {
+            stack.pop_back();
+            if(!visited[v]) { visited[v] = true; order.push_back(v); }
+            continue;
+        }
+        const auto e = incident[next[v]++];
+        used[e] = true;
+        stack.push_back(from[e] == v ? to[e] : from[e]);
+    }
+    stats.add(0, instrument::expanded, nodes);
+    stats.publish();
+    return detail::as_tour_either_way(mat, std::move(order));
+}
+
+template<typename Mat>
+inline auto tsp::space_filling_curve(const Mat& mat, const std::vector<std::array<double, 2>>& coords) -> result<Mat>
+{
+    const auto nodes = utils::nodes(mat);
+
+    // The points scaled into a 2^16 x 2^16 grid.
+    auto low  = std::array{std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+    auto high = std::array{std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+    for(std::size_t i = 0; i < nodes; ++i) {
+        for(std::size_t d = 0; d < 2; ++d) { low[d] = std::min(low[d], coords[i][d]); high[d] = std::max(high[d], coords[i][d]); }
+    }
+    constexpr auto side = std::uint32_t{1} << 16;
+    const auto span = std::max({high[0] - low[0], high[1] - low[1], 1e-9});
+
+    // Distance along the Hilbert curve: at each scale pick the quadrant and rotate the rest into place.
+    const auto hilbert = [&](const std::array<double, 2>& p) {
+        auto x = std::min(side - 1, static_cast<std::uint32_t>((p[0] - low[0]) / span * (side - 1)));
+        auto y = std::min(side - 1, static_cast<std::uint32_t>((p[1] - low[1]) / span * (side - 1)));
+        auto d = std::uint64_t{0};
+        for(auto s = side / 2; s; s /= 2)
+        {
+            const auto rx = (x & s) ? 1u : 0u;
+            const auto ry = (y & s) ? 1u : 0u;
+            d += std::uint64_t{s} * s * ((3 * rx) ^ ry);
+            if(!ry)
+            {
+                if(rx) { x = side - 1 - x; y = side - 1 - y; }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    };
+
+    auto keys  = std::vector<std::uint64_t>(nodes);
+    auto order = std::vector<std::size_t>(nodes);
+    for(std::size_t i = 0; i < nodes; ++i) { keys[i] = hilbert(coords[i]); }
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return keys[a] < keys[b] || (keys[a] == keys[b] && a < b); });
+    return detail::as_tour(mat, order);
+}
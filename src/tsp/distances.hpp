@@ -0,0 +1,249 @@
+/// Contains distance providers that need much less memory than a full matrix.
+//
+// A utils::matrix<int> of n nodes takes 4n^2 bytes, 10 GB at 50k nodes. The
+// heuristics (approx, the constructions, local_search, lin_kernighan) only
+// keep O(n * k) data of their own and read every cost through mat[{x, y}],
+// so any type with the same interface as bidimensional_access (value_type,
+// dims and operator[], where mat[{x, y}] is the cost of going from y to x)
+// can stand in for the matrix:
+//
+// - triangular_matrix: a symmetric matrix keeping only the costs with
+//   x <= y, half the memory of a full one.
+// - coordinate_matrix: the points and a distance function, O(n) memory, every
+//   lookup computes the distance. Solvers mostly scan a whole row at a time
+//   (prims, nearest_neighbor, k_nearest), so there is an optional cache of
+//   the last few rows per thread: after n / 8 lookups in a row missing on the
+//   same row, the whole row is computed into the cache. Short scans never pay
+//   for a row. For EUC_2D the sqrt is about as cheap as the cache, it pays
+//   off for the trigonometry of GEO.
+// - sparse_matrix: only the edges of a csr_graph, like the k_nearest of one of
+//   the above, O(n * k) memory. It is a way of keeping a candidate graph and
+//   looking up its costs, not a replacement for the matrix: any other pair
+//   costs `missing`, which the heuristics happily put in a tour (nearest
+//   neighbour runs out of candidates, a 2-opt move closes one), and every
+//   lookup scans the row, so solvers walking whole rows (prims, alpha_nearest,
+//   is_symmetric) get k times slower. Use has_edge to check a tour against it.
+//
+// The exact solvers index per node arrays and 64 bit sets, they are meant
+// for the dense matrices.
+#pragma once
+
+#include <type_traits> // For std::invoke_result_t.
+#include <stdexcept> // For std::invalid_argument.
+#include <algorithm> // For std::min and std::max.
+#include <cstdint> // For std::uint64_t.
+#include <cstddef> // For std::size_t.
+#include <atomic>
+#include <limits> // For std::numeric_limits.
+#include <vector>
+#include <array>
+#include <cmath> // For std::sqrt.
+
+#include "utils.hpp"
+#include "tsp/graph.hpp"
+
+namespace tsp
+{
+    template<typename T>
+    class triangular_matrix
+    {
+    public:
+        using value_type = T;
+
+        struct span {
+            std::size_t x;
+            std::size_t y;
+        } dims;
+
+        explicit triangular_matrix(std::size_t nodes)
+            : dims{ nodes, nodes }
+            , storage( nodes * (nodes + 1) / 2, T{} )
+        {}
+
+        // Copies a symmetric matrix, throws std::invalid_argument when it isn't.
+        template<typename Mat>
+        explicit triangular_matrix(const Mat& mat)
+            : triangular_matrix(utils::nodes(mat))
+        {
+            if(!utils::is_symmetric(mat)) throw std::invalid_argument{"triangular_matrix: the matrix isn't symmetric"};
+            for(std::size_t y = 0; y < dims.y; ++y) {
+                for(std::size_t x = 0; x <= y; ++x) { (*this)[{x, y}] = static_cast<T>(mat[{x, y}]); }
+            }
+        }
+
+        // Setting {x, y} sets {y, x} too.
+        auto operator[](span s) const -> const T& { return storage[index(s)]; }
+        auto operator[](span s) -> T& { return storage[index(s)]; }
+
+    private:
+        static auto index(span s) -> std::size_t
+        {
+            const auto [low, high] = std::minmax(s.x, s.y);
+            return high * (high + 1) / 2 + low;
+        }
+
+        std::vector<T> storage;
+    };
+
+    using point = std::array<double, 2>;
+
+    // Distance is called as distance(from, to) with two points.
+    template<typename Distance>
+    class coordinate_matrix
+    {
+    public:
+        using value_type = std::invoke_result_t<const Distance&, const point&, const point&>;
+
+        struct span {
+            std::size_t x;
+            std::size_t y;
+        } dims;
+
+        // Keeps cached_rows rows per thread, 0 for no cache.
+        explicit coordinate_matrix(std::vector<point> points, Distance distance = {}, std::size_t cached_rows = 0)
+            : dims{ points.size(), points.size() }
+            , coords{ std::move(points) }
+            , distance{ std::move(distance) }
+            , cached_rows{ cached_rows }
+        {}
+
+        // The diagonal is 0 whatever distance gives for a point and itself
+        // (TSPLIB's GEO gives 1).
+        auto operator[](span s) const -> value_type
+        {
+            if(s.x == s.y) return value_type{};
+            if(!cached_rows) return distance(coords[s.y], coords[s.x]);
+            return cached(s);
+        }
+
+        auto points() const -> const std::vector<point>& { return coords; }
+
+    private:
+        static constexpr auto none = std::numeric_limits<std::size_t>::max();
+
+        // Only for one matrix at a time, another one takes it over.
+        struct row_cache
+        {
+            std::uint64_t owner = 0;
+            std::vector<std::size_t> rows; // Which row each slot has.
+            std::vector<value_type> values;
+            std::size_t next      = 0;    // Slot to fill next, round robin.
+            std::size_t last_miss = none; // Row of the last lookups that missed, and how many.
+            std::size_t misses    = 0;
+            std::size_t hot_row   = none; // Row of the last lookup that hit, and its values.
+            const value_type* hot = nullptr;
+        };
+
+        static auto cache() -> row_cache&
+        {
+            thread_local auto rows = row_cache{};
+            return rows;
+        }
+        static auto next_id() -> std::uint64_t
+        {
+            static auto ids = std::atomic<std::uint64_t>{0};
+            return ++ids;
+        }
+
+        // A row is only worth computing for a scan of a good part of it.
+        auto fill_after() const -> std::size_t { return std::max<std::size_t>(2, dims.x / 8); }
+
+        auto cached(span s) const -> value_type
+        {
+            auto& c = cache();
+            if(c.owner == id && c.hot_row == s.y) return c.hot[s.x];
+            if(c.owner != id)
+            {
+                c.owner = id;
+                c.rows.assign(cached_rows, none);
+                c.values.resize(cached_rows * dims.x);
+                c.next = 0;
+                c.last_miss = none;
+                c.hot_row = none;
+            }
+            for(std::size_t slot = 0; slot < c.rows.size(); ++slot)
+            {
+                if(c.rows[slot] != s.y) continue;
+                c.hot_row = s.y;
+                c.hot = c.values.data() + slot * dims.x;
+                return c.hot[s.x];
+            }
+            if(c.last_miss != s.y)
+            {
+                c.last_miss = s.y;
+                c.misses = 0;
+            }
+            if(++c.misses < fill_after()) return distance(coords[s.y], coords[s.x]);
+
+            // Scanning this row, compute all of it.
+            const auto slot = c.next;
+            c.next = (c.next + 1) % c.rows.size();
+            c.rows[slot] = s.y;
+            auto* const row = c.values.data() + slot * dims.x;
+            for(std::size_t x = 0; x < dims.x; ++x) { row[x] = distance(coords[s.y], coords[x]); }
+            row[s.y] = value_type{};
+            c.hot_row = s.y;
+            c.hot = row;
+            return row[s.x];
+        }
+
+        std::vector<point> coords;
+        Distance distance;
+        std::size_t cached_rows;
+        std::uint64_t id = next_id(); // Copies share it, and the same costs.
+    };
+
+    // Rounded euclidean distance, like TSPLIB's EUC_2D.
+    struct euclidean_distance
+    {
+        auto operator()(const point& a, const point& b) const -> int
+        {
+            const auto dx = a[0] - b[0];
+            const auto dy = a[1] - b[1];
+            return static_cast<int>(std::sqrt(dx * dx + dy * dy) + 0.5);
+        }
+    };
+
+    template<typename T>
+    class sparse_matrix
+    {
+    public:
+        using value_type = T;
+
+        struct span {
+            std::size_t x;
+            std::size_t y;
+        } dims;
+
+        // graph's edges go from the node of the row to the target.
+        explicit sparse_matrix(csr_graph<T> graph, T missing = std::numeric_limits<T>::max() / 4)
+            : dims{ graph.nodes(), graph.nodes() }
+            , edges{ std::move(graph) }
+            , missing{ missing }
+        {}
+
+        // O(k), a scan of the row.
+        auto operator[](span s) const -> T
+        {
+            for(auto e = edges.offsets[s.y]; e < edges.offsets[s.y + 1]; ++e) {
+                if(edges.targets[e] == s.x) return edges.weights[e];
+            }
+            return s.x == s.y ? T{} : missing;
+        }
+
+        // Whether going from y to x is in the graph (or stays put), the other pairs cost `missing`.
+        auto has_edge(span s) const -> bool
+        {
+            for(auto e = edges.offsets[s.y]; e < edges.offsets[s.y + 1]; ++e) {
+                if(edges.targets[e] == s.x) return true;
+            }
+            return s.x == s.y;
+        }
+
+        auto graph() const -> const csr_graph<T>& { return edges; }
+
+    private:
+        csr_graph<T> edges;
+        T missing;
+    };
+}
@@ -0,0 +1,90 @@
+/// Contains a compressed sparse row graph and the k-nearest neighbour candidate graph.
+//
+// The dense matrices have an edge between every pair of nodes, but most of the
+// heuristics only ever look at the few closest neighbours of each node. A CSR
+// graph keeps those in three flat arrays:
+//
+//     offsets = {0, 2, 5, ...}      node i's edges are [offsets[i], offsets[i + 1])
+//     targets = {3, 7, 0, 4, 9, ...}
+//     weights = {5, 9, 2, 4, 6, ...}
+//
+// so walking the neighbours of a node is a linear scan over contiguous memory.
+#pragma once
+
+#include <algorithm> // For std::nth_element, std::sort and std::unique.
+#include <cstddef> // For std::size_t.
+#include <vector>
+
+#include "utils.hpp"
+
+namespace tsp
+{
+    template<typename T>
+    struct csr_graph
+    {
+        std::vector<std::size_t> offsets{0};
+        std::vector<std::size_t> targets;
+        std::vector<T> weights;
+
+        auto nodes() const -> std::size_t { return offsets.size() - 1; }
+        auto degree(std::size_t node) const -> std::size_t { return offsets[node + 1] - offsets[node]; }
+    };
+
+    // For each node, its k cheapest outgoing edges sorted by cost. With
+    // symmetric = true every edge is also added in the other direction (so
+    // nodes can end up with more than k neighbours), which makes it usable as
+    // an undirected graph, e.g. by sparse_prims.
+    template<typename Mat>
+    inline auto k_nearest(const Mat& mat, std::size_t k, bool symmetric = false) -> csr_graph<typename Mat::value_type>;
+}
+
+template<typename Mat>
+inline auto tsp::k_nearest(const Mat& mat, std::size_t k, bool symmetric) -> csr_graph<typename Mat::value_type>
+{
+    using T = typename Mat::value_type;
+    const auto nodes = utils::nodes(mat);
+    k = nodes ? std::min(k, nodes - 1) : 0;
+
+    // cost(from, to), following the same {to, from} convention as the solvers.
+    const auto cost = [&](std::size_t from, std::size_t to) -> T { return mat[{to, from}]; };
+
+    auto lists = std::vector<std::vector<std::size_t>>(nodes);
+    auto candidates = std::vector<std::size_t>{};
+    candidates.reserve(nodes);
+    for(std::size_t i = 0; i < nodes; ++i)
+    {
+        candidates.clear();
+        for(std::size_t j = 0; j < nodes; ++j) { if(j != i) candidates.push_back(j); }
+
+        const auto by_cost = [&](std::size_t a, std::size_t b) { return cost(i, a) < cost(i, b) || (cost(i, a) == cost(i, b) && a < b); };
+        std::nth_element(candidates.begin(), candidates.begin() + k, candidates.end(), by_cost);
+        std::sort(candidates.begin(), candidates.begin() + k, by_cost);
+        lists[i].assign(candidates.begin(), candidates.begin() + k);
+    }
+
+    if(symmetric)
+    {
+        for(std::size_t i = 0; i < nodes; ++i) {
+            for(std::size_t n = 0; n < k; ++n) { lists[lists[i][n]].push_back(i); }
+        }
+        for(std::size_t i = 0; i < nodes; ++i)
+        {
+            auto& list = lists[i];
+            const auto by_cost = [&](std::size_t a, std::size_t b) { return cost(i, a) < cost(i, b) || (cost(i, a) == cost(i, b) && a < b); };
+            std::sort(list.begin(), list.end(), by_cost);
+            list.erase(std::unique(list.begin(), list.end()), list.end());
+        }
+    }
+
+    auto graph = csr_graph<T>{};
+    graph.offsets.reserve(nodes + 1);
+    for(std::size_t i = 0; i < nodes; ++i)
+    {
+        for(const auto j : lists[i]) {
+            graph.targets.push_back(j);
+            graph.weights.push_back(cost(i, j));
+        }
+        graph.offsets.push_back(graph.targets.size());
+    }
+    return graph;
+}
@@ -0,0 +1,183 @@
+/// Contains the Held-Karp dynamic programming exact solver.
+//
+// Instead of walking every permutation like bf.hpp does we notice that the
+// cheapest way of visiting some set of nodes and ending on a given node does
+// not depend on the order those nodes were visited in, so we only have to
+// compute it once per (set, last node) pair.
+//
+// Since we always start (and end) on node 0 we leave it out of the set and
+// represent the sets as a bitmask over nodes 1..n-1, where bit (i - 1) means
+// node i was visited. Then:
+//
+//     dp[{i}][i]       = cost(0, i)
+//     dp[mask][last]   = min over prev in mask - {last} of
+//                            dp[mask - {last}][prev] + cost(prev, last)
+//     optimal cycle    = min over last of dp[all][last] + cost(last, 0)
+//
+// Every mask - {last} is numerically smaller than mask, so walking the masks
+// in increasing order guarantees the subproblems are ready when we need them.
+//
+// Alongside the costs we keep which prev gave us the minimum (the parent), so
+// we can walk back from the best last node and rebuild the cycle.
+//
+// This is O(2^n * n^2) time and O(2^n * n) memory instead of O(n!), p3 goes
+// from minutes to milliseconds, but the table grows quickly: p4 (22 nodes)
+// needs around 220MB and p5 (29 nodes) would need tens of gigabytes.
+//
+// The tables can be kept in a held_karp_buffers between calls, so solving
+// many instances in a row doesn't allocate them over and over.
+//
+// Partial costs are stored in 32 bits to halve the table, with the all-ones
+// value marking unreachable states. When a path of nodes - 1 of the most
+// expensive edge could reach that value we switch to 64 bit entries instead,
+// otherwise an expensive but reachable state would look unreachable.
+#pragma once
+
+#include <cstdint> // For std::uint8_t, std::uint32_t and std::uint64_t.
+#include <stdexcept> // For std::length_error.
+#include <limits> // For std::numeric_limits.
+#include <algorithm> // For std::max.
+#include <vector>
+#include <tuple>
+
+#include "utils.hpp"
+#include "tsp/result.hpp"
+
+namespace tsp
+{
+    struct held_karp_buffers
+    {
+        std::vector<std::uint32_t, utils::aligned_allocator<std::uint32_t>> dp;
+        std::vector<std::uint64_t, utils::aligned_allocator<std::uint64_t>> wide_dp; // Only for big costs.
+        std::vector<std::uint8_t, utils::aligned_allocator<std::uint8_t>> parent;
+    };
+
+    namespace detail
+    {
+        template<typename Mat, typename Partial, typename Alloc>
+        inline auto held_karp_table(
+            const Mat& mat,
+            std::vector<Partial, Alloc>& dp,
+            std::vector<std::uint8_t, utils::aligned_allocator<std::uint8_t>>& parent
+        ) -> result<Mat>;
+    }
+
+    // Throws std::length_error for runtime instances with more than 32 nodes.
+    template<typename Mat>
+    inline auto held_karp(const Mat& mat, held_karp_buffers& buffers) -> result<Mat>;
+
+    template<typename Mat>
+    inline auto held_karp(const Mat& mat) -> result<Mat>
+    {
+        auto buffers = held_karp_buffers{};
+        return held_karp(mat, buffers);
+    }
+}
+
+template<typename Mat>
+inline auto tsp::held_karp(const Mat& mat, held_karp_buffers& buffers) -> result<Mat>
+{
+    constexpr auto max_nodes = std::size_t{32}; // Masks are 32 bits wide (and parents 8 bits).
+    if constexpr(utils::fixed_nodes_v<Mat> != 0) {
+        static_assert(utils::fixed_nodes_v<Mat> >= 2, "held_karp needs at least 2 nodes");
+        static_assert(utils::fixed_nodes_v<Mat> <= max_nodes, "held_karp masks are 32 bits wide");
+    }
+    const auto nodes = utils::nodes(mat);
+    if(nodes > max_nodes) { throw std::length_error{"held_karp supports at most 32 nodes"}; }
+    if(nodes < 2) { return {0, utils::make_node_array<std::size_t, 1>(mat)}; }
+
+    // Every reachable partial sum is at most (nodes - 1) * the largest edge,
+    // it has to stay below the 32 bit unreachable mark.
+    auto max_edge = std::size_t{0};
+    for(std::size_t to = 0; to < nodes; ++to) {
+        for(std::size_t from = 0; from < nodes; ++from) {
+            if(to != from) max_edge = std::max<std::size_t>(max_edge, mat[{to, from}]);
+        }
+    }
+    constexpr auto narrow_inf = std::size_t{ std::numeric_limits<std::uint32_t>::max() };
+    if(max_edge <= (narrow_inf - 1) / (nodes - 1)) { return detail::held_karp_table(mat, buffers.dp, buffers.parent); }
+    return detail::held_karp_table(mat, buffers.wide_dp, buffers.parent);
+}
+
+template<typename Mat, typename Partial, typename Alloc>
+inline auto tsp::detail::held_karp_table(
+    const Mat& mat,
+    std::vector<Partial, Alloc>& dp,
+    std::vector<std::uint8_t, utils::aligned_allocator<std::uint8_t>>& parent
+) -> result<Mat>
+{
+    const auto nodes = utils::nodes(mat);
+    // Node 0 is not part of the masks, so every column is shifted by one.
+    const auto cols  = nodes - 1;
+    const auto masks = std::size_t{1} << cols;
+    // The sums are done in std::size_t, the all-ones entry means unreachable.
+    using partial = Partial;
+    constexpr auto inf = std::size_t{ std::numeric_limits<partial>::max() };
+
+    // cost(from, to), following the same {to, from} convention as the other solvers.
+    const auto cost = [&](std::size_t from, std::size_t to) -> std::size_t { return mat[{to, from}]; };
+
+    // Flat dp[mask][last] tables, last is the fastest moving index so all the
+    // entries of a mask share cache lines.
+    dp.assign(masks * cols, static_cast<partial>(inf));
+    parent.assign(masks * cols, 0);
+
+    for(std::size_t last = 0; last < cols; ++last) {
+        dp[(std::size_t{1} << last) * cols + last] = static_cast<partial>( cost(0, last + 1) );
+    }
+
+    for(std::size_t mask = 1; mask < masks; ++mask)
+    {
+        // Masks with a single bit set are the base cases filled above.
+        if(!(mask & (mask - 1))) continue;
+
+        auto* const row = dp.data() + mask * cols;
+        for(std::size_t last = 0; last < cols; ++last)
+        {
+            const auto last_bit = std::uint32_t{1} << last;
+            if(!(mask & last_bit)) continue;
+
+            const auto* const prev_row = dp.data() + (mask ^ last_bit) * cols;
+            auto best        = inf;
+            auto best_parent = std::size_t{0};
+            for(std::size_t prev = 0; prev < cols; ++prev)
+            {
+                if(prev_row[prev] == inf) continue; // Also skips prevs not in the mask.
+                const auto candidate = std::size_t{prev_row[prev]} + cost(prev + 1, last + 1);
+                if(candidate < best) {
+                    best        = candidate;
+                    best_parent = prev;
+                }
+            }
+            row[last] = static_cast<partial>( best < inf ? best : inf );
+            parent[mask * cols + last] = static_cast<std::uint8_t>(best_parent);
+        }
+    }
+
+    // Close the cycle back to node 0.
+    // The closing edge can take the total past inf, so start from the widest value.
+    const auto full = masks - 1;
+    auto lowest_cost = std::numeric_limits<std::size_t>::max();
+    auto last        = std::size_t{0};
+    for(std::size_t i = 0; i < cols; ++i)
+    {
+        const auto candidate = std::size_t{dp[full * cols + i]} + cost(i + 1, 0);
+        if(candidate < lowest_cost) {
+            lowest_cost = candidate;
+            last        = i;
+        }
+    }
+
+    // Walk the parents back, filling the cycle from the end.
+    auto smallest_cicle = utils::make_node_array<std::size_t, 1>(mat); // Both ends are 0.
+    auto mask = full;
+    for(auto pos = nodes - 1; pos >= 1; --pos)
+    {
+        smallest_cicle[pos] = last + 1;
+        const auto prev = parent[mask * cols + last];
+        mask ^= std::size_t{1} << last;
+        last  = prev;
+    }
+
+    return {lowest_cost, smallest_cicle};
+}
@@ -0,0 +1,136 @@
+/// Contains the instrumentation counters of the solvers, switched on at compile time.
+//
+// Build with TSP_INSTRUMENT=1 (`meson configure builddir -Dinstrument=true`)
+// to turn them on. When off, recorder is an empty class whose methods do
+// nothing, so every call to it compiles away.
+//
+// A solver makes a recorder with one slot per worker, counts into its own
+// worker's slot while it runs and publishes the whole thing when it's done:
+//
+//     auto stats = instrument::recorder{"par_brute_force", threads};
+//     ...
+//     stats.add(worker, instrument::prunes);
+//     ...
+//     stats.publish();
+//
+// Slots are cache line aligned, so workers counting at the same time never
+// write to the same line. They're only merged when printed.
+#pragma once
+
+#ifndef TSP_INSTRUMENT
+    #define TSP_INSTRUMENT 0
+#endif
+
+#include <cstddef> // For std::size_t.
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <array>
+#include <mutex>
+
+#include "utils.hpp"
+
+namespace tsp::instrument
+{
+    constexpr auto enabled = bool{TSP_INSTRUMENT};
+
+    enum counter : std::size_t
+    {
+        permutations, // Tours (or partial tours) looked at.
+        prunes,       // Cost loops cut short since they already cost too much.
+        expanded,     // Search nodes expanded: prefixes split, nodes added to a tree.
+        skipped,      // Prefixes dropped without looking at any of their tours.
+        lookups,      // Reads from the matrix.
+        counter_count
+    };
+    constexpr auto counter_names = std::array<const char*, counter_count>{
+        "permutations", "prunes", "expanded", "skipped", "lookups"
+    };
+
+    struct alignas(utils::cache_line) slot
+    {
+        std::array<std::uint64_t, counter_count> counts{};
+        std::chrono::nanoseconds busy{0}; // Time spent inside timed scopes.
+    };
+
+    // What one solver run published.
+    struct report
+    {
+        std::string solver;
+        std::chrono::nanoseconds wall{0}; // From the recorder's creation to publish().
+        std::vector<slot> workers;
+
+        auto total(counter c) const -> std::uint64_t
+        {
+            auto sum = std::uint64_t{0};
+            for(const auto& w : workers) { sum += w.counts[c]; }
+            return sum;
+        }
+    };
+
+    namespace detail
+    {
+        inline auto registry_lock = std::mutex{};
+        inline auto registry      = std::vector<report>{};
+    }
+
+    // The reports published since the last call, oldest first. Always empty when off.
+    inline auto take_reports() -> std::vector<report>
+    {
+        auto lock = std::scoped_lock{detail::registry_lock};
+        auto taken = std::vector<report>{};
+        taken.swap(detail::registry);
+        return taken;
+    }
+
+#if TSP_INSTRUMENT
+    class recorder
+    {
+    public:
+        explicit recorder(const char* solver, std::size_t workers = 1)
+            : solver{solver}
+            , slots(workers)
+            , start{std::chrono::steady_clock::now()}
+        {}
+
+        auto add(std::size_t worker, counter c, std::uint64_t n = 1) -> void { slots[worker].counts[c] += n; }
+
+        // Adds the time until it goes out of scope to the worker's busy time.
+        class timer
+        {
+        public:
+            timer(slot& s) : s{s}, start{std::chrono::steady_clock::now()} {}
+            ~timer() { s.busy += std::chrono::steady_clock::now() - start; }
+            timer(const timer&) = delete;
+            auto operator=(const timer&) -> timer& = delete;
+        private:
+            slot& s;
+            std::chrono::steady_clock::time_point start;
+        };
+        auto time(std::size_t worker) -> timer { return {slots[worker]}; }
+
+        auto publish() -> void
+        {
+            auto r = report{solver, std::chrono::steady_clock::now() - start, std::move(slots)};
+            auto lock = std::scoped_lock{detail::registry_lock};
+            detail::registry.push_back(std::move(r));
+        }
+
+    private:
+        const char* solver;
+        std::vector<slot> slots;
+        std::chrono::steady_clock::time_point start;
+    };
+#else
+    class recorder
+    {
+    public:
+        constexpr explicit recorder(const char*, std::size_t = 1) {}
+        constexpr auto add(std::size_t, counter, std::uint64_t = 1) const -> void {}
+        struct timer {};
+        constexpr auto time(std::size_t) const -> timer { return {}; }
+        constexpr auto publish() const -> void {}
+    };
+#endif
+}
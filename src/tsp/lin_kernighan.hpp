@@ -0,0 +1,369 @@
+/// Contains a Lin-Kernighan style heuristic for big instances (a small LKH).
+//
+// A Lin-Kernighan move is a chain of 2-opt moves that all share the node t1:
+//
+//     remove (t1, t2), add (t2, t3), remove (t3, t4), close with (t4, t1)
+//
+// after which t4 is the new neighbour of t1 and the chain can go on from it,
+// as long as what was removed so far still outweighs what was added (the
+// gain criterion). The chain is then cut back to its best point. The first
+// levels try a few alternatives each (breadth), deeper ones only the best.
+// When no chain improves a node, Or-opt moves are tried on it too.
+//
+// Candidates for t3 are the alpha-nearest neighbours of t2: alpha(i, j) is
+// how much the minimum spanning tree would grow if it had to include edge
+// (i, j), which is a much better guide than plain distance. They come from
+// the same prims as approx. Given the penalties of a held_karp_bound, alpha
+// is measured on the penalized costs instead, like LKH does.
+//
+// The tour is a two_level_tour, so each 2-opt move is O(sqrt(n)), and every
+// move is logged so it can be undone.
+//
+// After the first local optimum, each trial kicks the tour with a
+// double-bridge over a few nearby segments and optimizes again, keeping the
+// result if it isn't worse and undoing it otherwise. Trials go on until
+// there are no more of them or the time budget is over.
+//
+// This assumes a symmetric matrix, asymmetric ones get their start tour back.
+#pragma once
+
+#include <algorithm> // For std::nth_element, std::sort and std::find.
+#include <cstddef> // For std::size_t.
+#include <cstdint>
+#include <type_traits> // For std::conditional_t.
+#include <limits> // For std::numeric_limits.
+#include <chrono>
+#include <random>
+#include <vector>
+#include <deque>
+#include <array>
+
+#include "utils.hpp"
+#include "tsp/graph.hpp"
+#include "tsp/result.hpp"
+#include "tsp/approx.hpp"
+#include "tsp/one_tree.hpp"
+#include "tsp/local_search.hpp"
+#include "tsp/two_level_tour.hpp"
+
+namespace tsp
+{
+    struct lin_kernighan_options
+    {
+        std::size_t candidates = 5;  // Alpha-nearest neighbours per node.
+        std::size_t max_depth  = 50; // Most 2-opt moves in one chain.
+        std::array<std::size_t, 3> breadth = {5, 3, 1}; // Alternatives tried on the first levels.
+        std::size_t trials = 1000;
+        std::chrono::milliseconds time_budget{1000}; // For the trials, the first descent always runs.
+        std::uint32_t seed = 1;
+    };
+
+    // For each node, the k other nodes with the smallest alpha-nearness
+    // (ties going to the cheapest one), sorted by cost. O(n^2) time, O(n) extra memory.
+    template<typename Mat>
+    inline auto alpha_nearest(const Mat& mat, std::size_t k) -> csr_graph<typename Mat::value_type>;
+
+    // Same, with alpha on the costs penalized by the penalties of a held_karp_bound.
+    template<typename Mat>
+    inline auto alpha_nearest(const Mat& mat, std::size_t k, const std::vector<double>& penalties) -> csr_graph<typename Mat::value_type>;
+
+    template<typename Mat>
+    inline auto lin_kernighan(const Mat& mat, result<Mat> start, const lin_kernighan_options& options = {}) -> result<Mat>;
+
+    template<typename Mat>
+    inline auto lin_kernighan(const Mat& mat, const lin_kernighan_options& options = {}) -> result<Mat>
+    {
+        return lin_kernighan(mat, approx(mat), options);
+    }
+}
+
+namespace tsp::detail
+{
+    // alpha_nearest with the tree and alpha on tree_costs (any matrix), the candidates keep the costs of mat.
+    template<typename Mat, typename Costs>
+    inline auto alpha_nearest_on(const Mat& mat, const Costs& tree_costs, std::size_t k) -> csr_graph<typename Mat::value_type>
+    {
+        using T = typename Mat::value_type;
+        // alpha is fractional on penalized costs.
+        using A = std::conditional_t<std::is_floating_point_v<typename Costs::value_type>, double, long long>;
+        const auto nodes = utils::nodes(mat);
+        k = nodes ? std::min(k, nodes - 1) : 0;
+
+        const auto cost      = [&](std::size_t from, std::size_t to) -> long long { return static_cast<long long>(mat[{to, from}]); };
+        const auto tree_cost = [&](std::size_t from, std::size_t to) -> A { return static_cast<A>(tree_costs[{to, from}]); };
+
+        const auto parent = prims(tree_costs);
+        // Preorder of the tree, so every node comes after its parent.
+        auto topological = utils::make_node_array<std::size_t>(tree_costs);
+        tour_mst(tree_costs, parent, topological.begin());
+
+        // beta[j] is the heaviest edge on the tree path between i and j, so
+        // alpha(i, j) = cost(i, j) - beta[j]. For each i we first walk from i up
+        // to the root, then every other node takes it from its parent.
+        constexpr auto none = std::numeric_limits<std::size_t>::max();
+        auto beta = std::vector<A>(nodes);
+        auto mark = std::vector<std::size_t>(nodes, none);
+
+        struct candidate { A alpha; long long cost; std::size_t node; };
+        auto list = std::vector<candidate>{};
+        list.reserve(nodes);
+
+        auto graph = csr_graph<T>{};
+        graph.offsets.reserve(nodes + 1);
+        for(std::size_t i = 0; i < nodes; ++i)
+        {
+            beta[i] = std::numeric_limits<A>::lowest();
+            mark[i] = i;
+            for(auto v = i; parent[v] != v; v = parent[v]) {
+                beta[parent[v]] = std::max(beta[v], tree_cost(parent[v], v));
+                mark[parent[v]] = i;
+            }
+            for(const auto v : topological) {
+                if(mark[v] != i) beta[v] = std::max(beta[parent[v]], tree_cost(parent[v], v));
+            }
+
+            list.clear();
+            for(std::size_t j = 0; j < nodes; ++j) { if(j != i) list.push_back({tree_cost(i, j) - beta[j], cost(i, j), j}); }
+
+            const auto by_alpha = [](const candidate& a, const candidate& b) {
+                return a.alpha < b.alpha || (a.alpha == b.alpha && (a.cost < b.cost || (a.cost == b.cost && a.node < b.node)));
+            };
+            std::nth_element(list.begin(), list.begin() + k, list.end(), by_alpha);
+            // The moves stop scanning at the first neighbour that is too far away, so they want them by cost.
+            std::sort(list.begin(), list.begin() + k, [](const candidate& a, const candidate& b) {
+                return a.cost < b.cost || (a.cost == b.cost && a.node < b.node);
+            });
+
+            for(std::size_t n = 0; n < k; ++n) {
+                graph.targets.push_back(list[n].node);
+                graph.weights.push_back(static_cast<T>(list[n].cost));
+            }
+            graph.offsets.push_back(graph.targets.size());
+        }
+        return graph;
+    }
+}
+
+template<typename Mat>
+inline auto tsp::alpha_nearest(const Mat& mat, std::size_t k) -> csr_graph<typename Mat::value_type>
+{
+    return detail::alpha_nearest_on(mat, mat, k);
+}
+
+template<typename Mat>
+inline auto tsp::alpha_nearest(const Mat& mat, std::size_t k, const std::vector<double>& penalties) -> csr_graph<typename Mat::value_type>
+{
+    return detail::alpha_nearest_on(mat, penalized_costs<Mat>{mat, penalties}, k);
+}
+
+namespace tsp::detail
+{
+    template<typename Mat>
+    class lk_search
+    {
+    public:
+        using T = typename Mat::value_type;
+
+        lk_search(const Mat& mat, const cicle<Mat>& start, long long cost, const lin_kernighan_options& options)
+            : mat{mat}
+            , options{options}
+            , candidates{alpha_nearest(mat, options.candidates)}
+            , tour{start}
+            , cost{cost}
+            , in_queue(tour.size(), false)
+            , alternatives(options.max_depth)
+        {}
+
+        // cost(from, to), following the same {to, from} convention as the solvers.
+        auto d(std::size_t from, std::size_t to) const -> long long { return static_cast<long long>(mat[{to, from}]); }
+
+        // The tour interface, so the Or-opt moves of local_search work over it (and get logged).
+        auto size() const -> std::size_t { return tour.size(); }
+        auto next(std::size_t node) const -> std::size_t { return tour.next(node); }
+        auto prev(std::size_t node) const -> std::size_t { return tour.prev(node); }
+        auto two_opt_move(std::size_t a, std::size_t b, std::size_t c, std::size_t dd) -> void
+        {
+            cost += d(a, c) + d(b, dd) - d(a, b) - d(c, dd);
+            tour.two_opt_move(a, b, c, dd);
+            log.push_back({a, b, c, dd});
+        }
+
+        auto run(cicle<Mat>& out) -> long long
+        {
+            const auto deadline = std::chrono::steady_clock::now() + options.time_budget;
+            auto rng = std::mt19937{options.seed};
+
+            for(std::size_t i = 0; i < size(); ++i) { wake(i); }
+            optimize();
+            auto best = cost;
+
+            for(std::size_t trial = 0; trial < options.trials && size() >= 8; ++trial)
+            {
+                if(std::chrono::steady_clock::now() >= deadline) break;
+                log.clear();
+                kick(rng);
+                optimize();
+                if(cost <= best) best = cost;
+                else             undo_to(0);
+            }
+
+            tour.write(out);
+            return cost;
+        }
+
+    private:
+        struct move { std::size_t a, b, c, d; };
+        struct alternative { long long gain; std::size_t t3, t4; };
+        using edge = std::pair<std::size_t, std::size_t>;
+        static auto make_edge(std::size_t a, std::size_t b) -> edge { return a < b ? edge{a, b} : edge{b, a}; }
+
+        auto wake(std::size_t node) -> void { if(!in_queue[node]) { in_queue[node] = true; queue.push_back(node); } }
+
+        // Undoes logged moves until there are only mark left. The inverse of a
+        // move is another 2-opt move over the edges it added.
+        auto undo_to(std::size_t mark) -> void
+        {
+            while(log.size() > mark)
+            {
+                const auto [a, b, c, dd] = log.back();
+                log.pop_back();
+                cost += d(a, b) + d(c, dd) - d(a, c) - d(b, dd);
+                tour.two_opt_move(a, c, b, dd);
+            }
+        }
+
+        // Runs chains (and Or-opt) from the queued nodes until none improves.
+        auto optimize() -> void
+        {
+            const auto wake_fn = [this](std::size_t node) { wake(node); };
+            while(!queue.empty())
+            {
+                const auto t1 = queue.front();
+                queue.pop_front();
+
+                auto improved = false;
+                for(const auto t2 : {next(t1), prev(t1)}) { if(chain(t1, t2) > 0) { improved = true; break; } }
+                if(!improved) improved = try_or_opt(*this, [this](std::size_t a, std::size_t b) { return d(a, b); }, candidates, t1, wake_fn) > 0;
+
+                if(improved) { queue.push_back(t1); }
+                else         { in_queue[t1] = false; }
+            }
+        }
+
+        // Looks for the best chain that starts by removing (t1, t2), leaves
+        // the tour at it and returns its gain (or leaves it as is and returns 0).
+        auto chain(std::size_t t1, std::size_t t2) -> long long
+        {
+            const auto start = log.size();
+            best_gain = 0;
+            best_mark = start;
+            added.clear();
+            removed.assign(1, make_edge(t1, t2));
+
+            step(t1, t2, d(t1, t2), 0);
+            undo_to(best_mark);
+
+            for(auto m = start; m < log.size(); ++m) { for(const auto node : {log[m].a, log[m].b, log[m].c, log[m].d}) wake(node); }
+            return best_gain;
+        }
+
+        // t2 is a neighbour of t1 and gain is what the chain removed minus what
+        // it added, not counting the closing edge (t1, t2).
+        auto step(std::size_t t1, std::size_t t2, long long gain, std::size_t level) -> void
+        {
+            if(level == options.max_depth) return;
+            const auto forward = next(t1) == t2;
+
+            auto& found = alternatives[level];
+            found.clear();
+            for(auto e = candidates.offsets[t2]; e < candidates.offsets[t2 + 1]; ++e)
+            {
+                const auto t3 = candidates.targets[e];
+                const auto g1 = gain - d(t2, t3);
+                if(g1 <= 0) break; // Candidates are sorted by cost.
+                if(t3 == t1) continue;
+
+                // The other neighbour would split the tour in two cycles.
+                const auto t4 = forward ? prev(t3) : next(t3);
+                if(t4 == t2) continue;
+                // Never remove an edge the chain added, nor add one it removed.
+                if(std::find(added.begin(), added.end(), make_edge(t3, t4)) != added.end()) continue;
+                if(std::find(removed.begin(), removed.end(), make_edge(t2, t3)) != removed.end()) continue;
+
+                found.push_back({g1 + d(t3, t4), t3, t4});
+            }
+            std::sort(found.begin(), found.end(), [](const alternative& a, const alternative& b) { return a.gain > b.gain; });
+
+            const auto breadth = level < options.breadth.size() ? options.breadth[level] : std::size_t{1};
+            const auto tries = std::min(breadth, found.size());
+            for(std::size_t i = 0; i < tries; ++i)
+            {
+                const auto [g2, t3, t4] = found[i];
+                const auto mark = log.size();
+
+                two_opt_move(t1, t2, t4, t3);
+                added.push_back(make_edge(t2, t3));
+                removed.push_back(make_edge(t3, t4));
+                if(g2 - d(t4, t1) > best_gain) {
+                    best_gain = g2 - d(t4, t1);
+                    best_mark = log.size();
+                }
+
+                step(t1, t4, g2, level + 1);
+                if(best_gain > 0) return; // chain() cuts it back to the best point.
+
+                added.pop_back();
+                removed.pop_back();
+                undo_to(mark);
+            }
+        }
+
+        // Double-bridge over two short consecutive segments B and C after a
+        // random node v: v B C w -> v C B w, as three reversals.
+        auto kick(std::mt19937& rng) -> void
+        {
+            const auto longest = std::max<std::size_t>(1, std::min<std::size_t>(50, size() / 4));
+            auto length = std::uniform_int_distribution<std::size_t>{1, longest};
+            const auto advance = [&](std::size_t node, std::size_t by) { while(by--) node = next(node); return node; };
+
+            const auto v  = std::uniform_int_distribution<std::size_t>{0, size() - 1}(rng);
+            const auto b1 = next(v);
+            const auto b2 = advance(b1, length(rng) - 1);
+            const auto c1 = next(b2);
+            const auto c2 = advance(c1, length(rng) - 1);
+            const auto w  = next(c2);
+
+            two_opt_move(v, b1, c2, w);   // v c2..c1 b2..b1 w
+            two_opt_move(v, c2, c1, b2);  // v c1..c2 b2..b1 w
+            two_opt_move(c2, b2, b1, w);  // v c1..c2 b1..b2 w
+            for(const auto node : {v, b1, b2, c1, c2, w}) wake(node);
+        }
+
+        const Mat& mat;
+        const lin_kernighan_options& options;
+        const csr_graph<T> candidates;
+        two_level_tour tour;
+        long long cost;
+
+        std::vector<move> log;
+        std::deque<std::size_t> queue;
+        std::vector<char> in_queue;
+
+        // State of the chain being searched.
+        long long best_gain = 0;
+        std::size_t best_mark = 0;
+        std::vector<edge> added;
+        std::vector<edge> removed;
+        std::vector<std::vector<alternative>> alternatives; // One per level.
+    };
+}
+
+template<typename Mat>
+inline auto tsp::lin_kernighan(const Mat& mat, result<Mat> start, const lin_kernighan_options& options) -> result<Mat>
+{
+    if(utils::nodes(mat) < 5 || !utils::is_symmetric(mat)) return start;
+
+    auto search = detail::lk_search<Mat>{mat, std::get<1>(start), static_cast<long long>(std::get<0>(start)), options};
+    std::get<0>(start) = static_cast<std::size_t>(search.run(std::get<1>(start)));
+    return start;
+}
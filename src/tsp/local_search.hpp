@@ -0,0 +1,270 @@
+/// Contains a local search stage that improves any tour with 2-opt and Or-opt moves.
+//
+// 2-opt removes two edges and reconnects the two paths the other way around,
+// which is the same as reversing one of them:
+//
+//     ... a b ... c d ...   ->   ... a c ... b d ...
+//
+// Or-opt takes a segment of 1 to 3 nodes out of the tour and puts it between
+// two other neighbouring nodes, either way around:
+//
+//     ... x s1 s2 y ... p q ...   ->   ... x y ... p s1 s2 q ...
+//
+// which we do as two or three 2-opt moves, so reversals are the only way the
+// tour ever changes.
+//
+// To keep each pass close to linear:
+// - The tour is an array plus the position of each node in it, so next/prev
+//   are O(1), and a reversal always flips the shorter side of the cycle.
+// - Moves are only looked for between a node and its k nearest neighbours,
+//   sorted by cost, and the scan stops as soon as no gain is possible.
+// - Don't-look bits: only nodes that are in the work queue are looked at, and
+//   a node goes back into it only when one of its tour edges changes.
+//
+// This assumes a symmetric matrix, asymmetric ones are left untouched.
+#pragma once
+
+#include <algorithm> // For std::swap and std::min.
+#include <cstddef> // For std::size_t.
+#include <chrono>
+#include <vector>
+#include <deque>
+
+#include "utils.hpp"
+#include "tsp/graph.hpp"
+#include "tsp/result.hpp"
+
+namespace tsp
+{
+    struct local_search_options
+    {
+        std::size_t neighbours = 8; // Size of the candidate lists.
+        bool two_opt = true;
+        bool or_opt  = true;
+    };
+
+    struct local_search_report
+    {
+        std::size_t cost_before = 0;
+        std::size_t cost_after  = 0;
+        std::size_t two_opt_moves = 0;
+        std::size_t or_opt_moves  = 0;
+        std::chrono::nanoseconds time{0};
+    };
+
+    // Improves cicle (which starts and ends on node 0, like the solvers return it) in place.
+    template<typename Mat, typename Cicle>
+    inline auto local_search(const Mat& mat, Cicle& cicle, const local_search_options& options = {}) -> local_search_report;
+
+    // Convenience for chaining after a solver: local_search(mat, approx(mat)).
+    template<typename Mat>
+    inline auto local_search(const Mat& mat, result<Mat> solved, const local_search_options& options = {})
+        -> std::tuple<result<Mat>, local_search_report>
+    {
+        const auto report = local_search(mat, std::get<1>(solved), options);
+        std::get<0>(solved) = report.cost_after;
+        return {std::move(solved), report};
+    }
+}
+
+namespace tsp::detail
+{
+    // A cyclic tour as an array of nodes and the index of each node in it.
+    class array_tour
+    {
+    public:
+        template<typename Cicle>
+        explicit array_tour(const Cicle& cicle)
+            : order(cicle.begin(), cicle.end() - 1)
+            , position(order.size())
+        {
+            for(std::size_t i = 0; i < order.size(); ++i) { position[order[i]] = i; }
+        }
+
+        auto size() const -> std::size_t { return order.size(); }
+        auto next(std::size_t node) const -> std::size_t { const auto p = position[node] + 1; return order[p == order.size() ? 0 : p]; }
+        auto prev(std::size_t node) const -> std::size_t { const auto p = position[node]; return order[p == 0 ? order.size() - 1 : p - 1]; }
+
+        // Removes edges (a, b) and (c, d) and adds (a, c) and (b, d). b must
+        // follow a and d follow c, in either direction (both the same one).
+        auto two_opt_move(std::size_t a, std::size_t b, std::size_t c, std::size_t d) -> void
+        {
+            if(next(a) == b) reverse_path(b, c);
+            else             reverse_path(a, d);
+        }
+
+        // Writes the tour back starting (and ending) on node 0.
+        template<typename Cicle>
+        auto write(Cicle& cicle) const -> void
+        {
+            const auto start = position[0];
+            for(std::size_t i = 0; i < order.size(); ++i) { cicle[i] = order[(start + i) % order.size()]; }
+            cicle[order.size()] = 0;
+        }
+
+    private:
+        // Reverses the path from -> ... -> to (following next). Reversing the
+        // rest of the cycle instead gives the same tour, so we flip the shorter one.
+        auto reverse_path(std::size_t from, std::size_t to) -> void
+        {
+            const auto n = order.size();
+            auto i = position[from];
+            auto j = position[to];
+            auto inner = (j + n - i) % n + 1;
+            if(2 * inner > n)
+            {
+                const auto new_i = (j + 1) % n;
+                j = (i + n - 1) % n;
+                i = new_i;
+                inner = n - inner;
+            }
+            for(std::size_t k = 0; k < inner / 2; ++k)
+            {
+                std::swap(order[i], order[j]);
+                position[order[i]] = i;
+                position[order[j]] = j;
+                i = i + 1 == n ? 0 : i + 1;
+                j = j == 0 ? n - 1 : j - 1;
+            }
+        }
+
+        std::vector<std::size_t> order;
+        std::vector<std::size_t> position;
+    };
+}
+
+// The moves themselves work on any tour with next(), prev(), size() and
+// two_opt_move() (the Lin-Kernighan engine uses them over its own tour).
+// Both return the gain of the move they made, or 0 when they found none, and
+// call wake(node) for every node whose tour edges changed.
+namespace tsp::detail
+{
+    // Tries 2-opt moves that replace (a, succ) with (a, c), succ being next or prev.
+    template<typename Tour, typename Cost, typename T, typename Wake>
+    inline auto try_two_opt(Tour& tour, const Cost& d, const csr_graph<T>& candidates, std::size_t a, Wake&& wake) -> long long
+    {
+        for(const auto forward : {true, false})
+        {
+            const auto b    = forward ? tour.next(a) : tour.prev(a);
+            const auto d_ab = d(a, b);
+            for(auto e = candidates.offsets[a]; e < candidates.offsets[a + 1]; ++e)
+            {
+                const auto c    = candidates.targets[e];
+                const auto d_ac = d(a, c);
+                // Neighbours are sorted, past this point the new edge alone is too long.
+                if(d_ac >= d_ab) break;
+
+                const auto dd = forward ? tour.next(c) : tour.prev(c);
+                if(c == b || dd == a) continue;
+                const auto delta = d_ac + d(b, dd) - d_ab - d(c, dd);
+                if(delta < 0)
+                {
+                    tour.two_opt_move(a, b, c, dd);
+                    for(const auto node : {a, b, c, dd}) wake(node);
+                    return -delta;
+                }
+            }
+        }
+        return 0;
+    }
+
+    // Tries moving the segment of 1 to 3 nodes starting at s1 next to one of
+    // the neighbours of its ends.
+    template<typename Tour, typename Cost, typename T, typename Wake>
+    inline auto try_or_opt(Tour& tour, const Cost& d, const csr_graph<T>& candidates, std::size_t s1, Wake&& wake) -> long long
+    {
+        auto s2 = s1;
+        for(std::size_t length = 1; length <= 3 && length + 2 < tour.size(); ++length, s2 = tour.next(s2))
+        {
+            const auto x = tour.prev(s1);
+            const auto y = tour.next(s2);
+            const auto removed = d(x, s1) + d(s2, y) - d(x, y);
+            if(removed <= 0) continue;
+
+            const auto in_segment = [&](std::size_t node) {
+                for(auto s = s1;; s = tour.next(s)) { if(s == node) return true; if(s == s2) return false; }
+            };
+
+            for(const auto end : {s1, s2})
+            {
+                for(auto e = candidates.offsets[end]; e < candidates.offsets[end + 1]; ++e)
+                {
+                    const auto c = candidates.targets[e];
+                    if(d(end, c) >= removed) break;
+                    if(in_segment(c)) continue;
+
+                    // Put the segment between p and q = next(p), with c as either of them.
+                    for(const auto p : {c, tour.prev(c)})
+                    {
+                        const auto q = tour.next(p);
+                        // q == x would be the same as moving x over to the other side of the segment.
+                        if(in_segment(p) || in_segment(q) || q == x) continue;
+
+                        const auto base     = -d(p, q) - removed;
+                        const auto as_is    = base + d(p, s1) + d(s2, q);
+                        const auto reversed = base + d(p, s2) + d(s1, q);
+                        if(as_is >= 0 && reversed >= 0) continue;
+
+                        // x s1..s2 y ... p q  ->  x p..y s2..s1 q  ->  x y..p s2..s1 q
+                        if(p != y)
+                        {
+                            tour.two_opt_move(x, s1, p, q);
+                            tour.two_opt_move(x, p, y, s2);
+                        }
+                        else { tour.two_opt_move(x, s1, y, q); }
+                        // -> x y..p s1..s2 q
+                        if(as_is < reversed && s1 != s2) tour.two_opt_move(p, s2, s1, q);
+
+                        for(const auto node : {x, y, p, q, s1, s2}) wake(node);
+                        return -std::min(as_is, reversed);
+                    }
+                }
+            }
+        }
+        return 0;
+    }
+}
+
+template<typename Mat, typename Cicle>
+inline auto tsp::local_search(const Mat& mat, Cicle& cicle, const local_search_options& options) -> local_search_report
+{
+    const auto start = std::chrono::steady_clock::now();
+    const auto nodes = utils::nodes(mat);
+
+    // cost(from, to), following the same {to, from} convention as the solvers.
+    const auto d = [&](std::size_t from, std::size_t to) -> long long { return static_cast<long long>(mat[{to, from}]); };
+
+    auto report = local_search_report{};
+    for(std::size_t i = 1; i < cicle.size(); ++i) { report.cost_before += d(cicle[i - 1], cicle[i]); }
+    report.cost_after = report.cost_before;
+
+    if(nodes < 5 || !utils::is_symmetric(mat)) {
+        report.time = std::chrono::steady_clock::now() - start;
+        return report;
+    }
+
+    const auto candidates = k_nearest(mat, options.neighbours);
+    auto tour = detail::array_tour{cicle};
+
+    auto queue    = std::deque<std::size_t>{};
+    auto in_queue = std::vector<char>(nodes, true);
+    for(std::size_t i = 0; i < nodes; ++i) { queue.push_back(cicle[i]); }
+    const auto wake = [&](std::size_t node) { if(!in_queue[node]) { in_queue[node] = true; queue.push_back(node); } };
+
+    while(!queue.empty())
+    {
+        const auto a = queue.front();
+        queue.pop_front();
+
+        auto gain = options.two_opt ? detail::try_two_opt(tour, d, candidates, a, wake) : 0;
+        if(gain) { ++report.two_opt_moves; }
+        else if(options.or_opt && (gain = detail::try_or_opt(tour, d, candidates, a, wake))) { ++report.or_opt_moves; }
+
+        if(gain) { report.cost_after -= static_cast<std::size_t>(gain); queue.push_back(a); }
+        else     { in_queue[a] = false; }
+    }
+
+    tour.write(cicle);
+    report.time = std::chrono::steady_clock::now() - start;
+    return report;
+}
@@ -0,0 +1,304 @@
+/// Contains the Held-Karp 1-tree lower bound, to tell how far any tour can be from the optimum.
+//
+// A 1-tree is a spanning tree over nodes 1..n-1 plus the two cheapest edges
+// touching node 0. Every tour is a 1-tree where every node has degree 2, so
+// the cheapest 1-tree is a lower bound on the cost of any tour.
+//
+// It stays one if we add pi[i] + pi[j] to every edge (i, j) and take
+// 2 * sum(pi) back out at the end, since that adds the same to every tour.
+// The subgradient method of Held and Karp moves pi towards the penalties
+// giving the biggest bound: after each 1-tree
+//
+//     pi[i] += scale * (upper_bound - weight) / sum((degree - 2)^2) * (degree[i] - 2)
+//
+// so nodes with degree > 2 get more expensive and leaves get cheaper, pushing
+// the tree towards a tour. The scale starts at 2 and is halved every time
+// `patience` iterations go by without a better bound. It stops when the scale
+// gets too small, when the 1-tree is a tour (nothing can do better) or when
+// the bound reaches the upper bound (the tour that gave it is optimal).
+//
+// Asymmetric matrices use min(cost(a, b), cost(b, a)) for every edge, which
+// still gives a bound, just a looser one.
+//
+// Every iteration is a dense O(n^2) Prim. The symmetric costs and the scratch
+// arrays live in a one_tree_buffers that can be kept between calls, so after
+// the first call it is O(n^2 * iterations) with no allocations. Above
+// one_tree_dense_limit nodes the costs aren't copied (that would be 8n^2
+// bytes) but read from the matrix every time, which also works with the
+// compact matrices of distances.hpp.
+//
+// The bound certifies the gap of the tour of any solver:
+//
+//     const auto [cost, tour] = tsp::lin_kernighan(mat);
+//     const auto report = tsp::certify(mat, cost);
+//     report.gap() // 0.01 means the tour is at most 1% more expensive than the optimum.
+//
+// The penalties are returned too: branch_and_bound uses them for its spanning
+// tree bound, and alpha_nearest can take them to rank candidates on the
+// penalized costs (through penalized_costs).
+#pragma once
+
+#include <algorithm> // For std::min and std::max.
+#include <cmath> // For std::ceil.
+#include <cstddef> // For std::size_t.
+#include <limits> // For std::numeric_limits.
+#include <vector>
+
+#include "utils.hpp"
+#include "tsp/approx.hpp"
+
+namespace tsp
+{
+    // Most nodes for which the symmetric costs are copied into one_tree_buffers, 128 MB of them.
+    constexpr auto one_tree_dense_limit = std::size_t{4096};
+
+    struct one_tree_options
+    {
+        std::size_t iterations = 0; // Most subgradient steps, 0 for 100 * nodes (but at most 1000).
+        std::size_t patience   = 0; // Steps without a better bound before halving the scale, 0 for min(nodes, iterations / 20).
+        double initial_scale   = 2.0;
+        double min_scale       = 1e-4;
+    };
+
+    struct one_tree_buffers
+    {
+        std::vector<double> costs; // costs[a * nodes + b] = min(cost(a, b), cost(b, a)), empty above one_tree_dense_limit.
+        std::vector<double> pi;
+        std::vector<double> key;
+        std::vector<std::size_t> parent;
+        std::vector<std::size_t> degree;
+        std::vector<char> in_tree;
+    };
+
+    struct one_tree_bound
+    {
+        std::size_t bound;              // No tour costs less than this.
+        std::vector<double> penalties;  // The pi that gave bound.
+        std::size_t iterations;
+        bool is_tour;                   // The best 1-tree was a tour, so with a symmetric matrix bound is the optimum.
+    };
+
+    // upper_bound is the cost of any tour, it sets the size of the steps.
+    template<typename Mat>
+    inline auto held_karp_bound(
+        const Mat& mat,
+        std::size_t upper_bound,
+        one_tree_buffers& buffers,
+        const one_tree_options& options = {}
+    ) -> one_tree_bound;
+
+    template<typename Mat>
+    inline auto held_karp_bound(const Mat& mat, std::size_t upper_bound, const one_tree_options& options = {}) -> one_tree_bound
+    {
+        auto buffers = one_tree_buffers{};
+        return held_karp_bound(mat, upper_bound, buffers, options);
+    }
+
+    // With the tour of approx as the upper bound.
+    template<typename Mat>
+    inline auto held_karp_bound(const Mat& mat) -> one_tree_bound
+    {
+        return held_karp_bound(mat, std::get<0>(approx(mat)));
+    }
+
+    struct gap_report
+    {
+        std::size_t cost;
+        std::size_t bound;
+
+        // (cost - bound) / bound, how much more than the optimum the tour can cost at most.
+        auto gap() const -> double
+        {
+            if(cost <= bound) return 0;
+            return bound ? (static_cast<double>(cost) - bound) / bound : std::numeric_limits<double>::infinity();
+        }
+        // The tour is certainly optimal.
+        auto optimal() const -> bool { return cost <= bound; }
+    };
+
+    // The gap of a tour costing cost, from any solver.
+    template<typename Mat>
+    inline auto certify(const Mat& mat, std::size_t cost, one_tree_buffers& buffers, const one_tree_options& options = {}) -> gap_report
+    {
+        return {cost, held_karp_bound(mat, cost, buffers, options).bound};
+    }
+
+    template<typename Mat>
+    inline auto certify(const Mat& mat, std::size_t cost, const one_tree_options& options = {}) -> gap_report
+    {
+        auto buffers = one_tree_buffers{};
+        return certify(mat, cost, buffers, options);
+    }
+
+    // The same interface as the matrices, over the costs the 1-tree sees:
+    // min(cost(a, b), cost(b, a)) + pi[a] + pi[b]. Lets the solvers that take
+    // any matrix (like prims) work on the penalized costs.
+    template<typename Mat>
+    struct penalized_costs
+    {
+        using value_type = double;
+
+        struct span {
+            std::size_t x;
+            std::size_t y;
+        } dims;
+
+        const Mat& mat;
+        const std::vector<double>& pi;
+
+        penalized_costs(const Mat& mat, const std::vector<double>& pi)
+            : dims{ utils::nodes(mat), utils::nodes(mat) }
+            , mat{ mat }
+            , pi{ pi }
+        {}
+
+        auto operator[](span s) const -> double
+        {
+            return static_cast<double>(std::min(mat[{s.x, s.y}], mat[{s.y, s.x}])) + pi[s.x] + pi[s.y];
+        }
+    };
+}
+
+namespace tsp::detail
+{
+    // Weight of the cheapest 1-tree with the penalized costs (without taking
+    // 2 * sum(pi) out), filling buffers.degree. edge(a, b) is the symmetric cost.
+    template<typename Edge>
+    inline auto one_tree(one_tree_buffers& buffers, std::size_t nodes, Edge&& edge) -> double
+    {
+        const auto& pi = buffers.pi;
+        const auto penalized = [&](std::size_t a, std::size_t b) { return edge(a, b) + pi[a] + pi[b]; };
+
+        auto& key     = buffers.key;
+        auto& parent  = buffers.parent;
+        auto& degree  = buffers.degree;
+        auto& in_tree = buffers.in_tree;
+        for(std::size_t i = 0; i < nodes; ++i) {
+            key[i]     = std::numeric_limits<double>::max();
+            in_tree[i] = false;
+            degree[i]  = 0;
+        }
+
+        // Prim over 1..n-1, ties going to the lowest node.
+        auto weight = 0.0;
+        key[1] = 0;
+        for(std::size_t added = 1; added < nodes; ++added)
+        {
+            auto next = nodes;
+            for(std::size_t i = 1; i < nodes; ++i) {
+                if(!in_tree[i] && (next == nodes || key[i] < key[next])) { next = i; }
+            }
+            in_tree[next] = true;
+            weight += key[next];
+            if(added > 1) { ++degree[next]; ++degree[parent[next]]; }
+            for(std::size_t i = 1; i < nodes; ++i)
+            {
+                if(in_tree[i]) continue;
+                const auto w = penalized(next, i);
+                if(w < key[i]) { key[i] = w; parent[i] = next; }
+            }
+        }
+
+        // And the two cheapest edges of 0.
+        auto first  = std::size_t{1};
+        auto second = std::size_t{2};
+        if(penalized(0, second) < penalized(0, first)) std::swap(first, second);
+        for(std::size_t i = 3; i < nodes; ++i)
+        {
+            if(penalized(0, i) < penalized(0, first))       { second = first; first = i; }
+            else if(penalized(0, i) < penalized(0, second)) { second = i; }
+        }
+        weight += penalized(0, first) + penalized(0, second);
+        degree[0] = 2; ++degree[first]; ++degree[second];
+        return weight;
+    }
+
+    // Costs are integers, so a fractional bound can be rounded up, with some
+    // slack for rounding errors. weight is a sum of n doubles (and 2 * sum(pi)
+    // taken out), whose error grows with its magnitude (about n * 2^-53 of it),
+    // so the slack is relative: 1e-9 is far above that for any n we can solve,
+    // and only costs the bound a unit once weights pass 10^9.
+    inline auto as_integer_bound(double weight) -> std::size_t
+    {
+        if(weight <= 0) return 0;
+        return static_cast<std::size_t>( std::ceil(weight - std::max(1e-6, 1e-9 * weight)) );
+    }
+}
+
+template<typename Mat>
+inline auto tsp::held_karp_bound(
+    const Mat& mat,
+    std::size_t upper_bound,
+    one_tree_buffers& buffers,
+    const one_tree_options& options
+) -> one_tree_bound
+{
+    const auto nodes = utils::nodes(mat);
+    auto result = one_tree_bound{0, std::vector<double>(nodes, 0.0), 0, false};
+    // Costs are non-negative, with less than 3 nodes there is no 1-tree to speak of.
+    if(nodes < 3) return result;
+
+    const auto dense = nodes <= one_tree_dense_limit;
+    if(dense)
+    {
+        buffers.costs.resize(nodes * nodes);
+        for(std::size_t a = 0; a < nodes; ++a) {
+            for(std::size_t b = 0; b < nodes; ++b) {
+                buffers.costs[a * nodes + b] = static_cast<double>(std::min(mat[{a, b}], mat[{b, a}]));
+            }
+        }
+    }
+    else { buffers.costs.clear(); }
+    const auto edge = [&](std::size_t a, std::size_t b) {
+        return dense ? buffers.costs[a * nodes + b] : static_cast<double>(std::min(mat[{a, b}], mat[{b, a}]));
+    };
+    buffers.pi.assign(nodes, 0.0);
+    buffers.key.resize(nodes);
+    buffers.parent.resize(nodes);
+    buffers.degree.resize(nodes);
+    buffers.in_tree.resize(nodes);
+
+    auto& pi = buffers.pi;
+    const auto iterations = options.iterations ? options.iterations : std::min<std::size_t>(100 * nodes, 1000);
+    // Leaves room for the scale to halve a good number of times before the iterations run out.
+    const auto patience   = options.patience ? options.patience : std::max<std::size_t>(1, std::min(nodes, iterations / 20));
+
+    auto best_bound = 0.0;
+    auto scale = options.initial_scale;
+    auto since_improvement = std::size_t{0};
+    for(; result.iterations < iterations && scale > options.min_scale; ++result.iterations)
+    {
+        auto weight = detail::one_tree(buffers, nodes, edge);
+        for(std::size_t i = 0; i < nodes; ++i) { weight -= 2 * pi[i]; }
+
+        if(weight > best_bound + 1e-9) {
+            best_bound = weight;
+            result.penalties.assign(pi.begin(), pi.end());
+            since_improvement = 0;
+            // The tour that gave upper_bound is optimal, no need to go on.
+            if(detail::as_integer_bound(best_bound) >= upper_bound) { ++result.iterations; break; }
+        }
+        else if(++since_improvement >= patience) {
+            scale /= 2;
+            since_improvement = 0;
+        }
+
+        auto norm = 0.0;
+        for(std::size_t i = 0; i < nodes; ++i) { norm += (double(buffers.degree[i]) - 2) * (double(buffers.degree[i]) - 2); }
+        if(norm == 0)
+        {
+            // The 1-tree is a tour, can't do any better.
+            best_bound = std::max(best_bound, weight);
+            result.penalties.assign(pi.begin(), pi.end());
+            result.is_tour = true;
+            ++result.iterations;
+            break;
+        }
+
+        const auto step = scale * (double(upper_bound) - weight) / norm;
+        for(std::size_t i = 0; i < nodes; ++i) { pi[i] += step * (double(buffers.degree[i]) - 2); }
+    }
+
+    result.bound = detail::as_integer_bound(best_bound);
+    return result;
+}
@@ -0,0 +1,19 @@
+/// What every solver returns.
+#pragma once
+
+#include <cstddef> // For std::size_t.
+#include <tuple>
+
+#include "utils.hpp"
+
+namespace tsp
+{
+    // The visiting order, it begins and ends on node 0 (so it has one slot more than there are nodes).
+    // A std::array for compile time instances and a std::vector for runtime ones.
+    template<typename Mat>
+    using cicle = utils::node_array<std::size_t, Mat, 1>;
+
+    // The cost of the cycle, and the cycle.
+    template<typename Mat>
+    using result = std::tuple< std::size_t, cicle<Mat> >;
+}
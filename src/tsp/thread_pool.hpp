@@ -0,0 +1,85 @@
+/// Contains a persistent pool of worker threads.
+//
+// run_work_stealing makes (and joins) its threads on every call, which is
+// fine for one big search but not for many small ones, where starting the
+// threads can take longer than the solving. This pool starts its threads
+// once and feeds them jobs from a shared queue until it is destroyed.
+//
+// Every job gets the index of the worker running it, so callers can keep
+// per-worker state (like scratch buffers) without any locking.
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <algorithm> // For std::max.
+#include <cstddef> // For std::size_t.
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+#include "tsp/work_stealing.hpp" // For default_workers.
+
+namespace tsp
+{
+    class thread_pool
+    {
+    public:
+        using job = std::function<void(std::size_t worker)>;
+
+        explicit thread_pool(std::size_t threads = default_workers())
+        {
+            threads = std::max<std::size_t>(1, threads);
+            workers.reserve(threads);
+            for(std::size_t i = 0; i < threads; ++i) { workers.emplace_back([this, i]{ worker_loop(i); }); }
+        }
+
+        // Runs whatever is still queued and joins the threads.
+        ~thread_pool()
+        {
+            {
+                auto lock = std::scoped_lock{queue_lock};
+                stopping = true;
+            }
+            wake.notify_all();
+            for(auto& worker : workers) { worker.join(); }
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        auto operator=(const thread_pool&) -> thread_pool& = delete;
+
+        auto size() const -> std::size_t { return workers.size(); }
+
+        auto submit(job j) -> void
+        {
+            {
+                auto lock = std::scoped_lock{queue_lock};
+                jobs.push_back(std::move(j));
+            }
+            wake.notify_one();
+        }
+
+    private:
+        auto worker_loop(std::size_t worker) -> void
+        {
+            while(true)
+            {
+                auto j = job{};
+                {
+                    auto lock = std::unique_lock{queue_lock};
+                    wake.wait(lock, [&]{ return stopping || !jobs.empty(); });
+                    if(jobs.empty()) return; // Only when stopping.
+                    j = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+                j(worker);
+            }
+        }
+
+        std::mutex queue_lock;
+        std::condition_variable wake;
+        std::deque<job> jobs;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+    };
+}
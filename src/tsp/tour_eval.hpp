@@ -0,0 +1,259 @@
+/// Contains a kernel that scores many tours (or paths) at once with SIMD gathers.
+//
+// Summing the cost of a tour is a chain of dependent lookups, mat[{v[i], v[i - 1]}]
+// one after the other, which keeps the CPU waiting on memory most of the time.
+// Scoring a batch of tours side by side turns it into one gather per position:
+// lane k of the vector sums the edges of tour k, so 8 (AVX2) or 16 (AVX-512)
+// lookups are in flight at once.
+//
+// The tours of a batch are stored position major, paths[pos * lanes + lane] is
+// the node at pos of tour lane, so each gather reads its indices with a
+// single load:
+//
+//     pos 0:  0  0  0  0 ...
+//     pos 1:  7  7  7  7 ...
+//     pos 2:  4  4  4  4 ...
+//     ...
+//     pos 9:  2  5  2  6 ...
+//     pos 10: 5  2  6  2 ...
+//
+// The evaluator keeps its own copy of the matrix, narrowed to the smallest
+// unsigned type that holds every cost (16 bits for p1 to p3), with rows
+// padded to a power of two so the index of an edge is a shift and an add.
+// Costs are assumed to be non-negative.
+//
+// The kernel is picked at runtime (with CPUID, through __builtin_cpu_supports)
+// among AVX-512, AVX2 and a plain scalar loop, so the same binary runs
+// anywhere. The scalar one is also used when the tour costs don't fit the
+// 32 bit sums of the vector ones.
+//
+// AVX-512 is only used when asked for: its gathers load as many elements per
+// cycle as two AVX2 ones, and when the brute force calls the kernel between
+// its scalar work it pays for turning the wide units on and off, which made
+// seq_brute_force_batched twice as slow on p1.
+#pragma once
+
+#include <algorithm> // For std::min and std::max.
+#include <cstdint> // For the fixed width integers.
+#include <cstddef> // For std::size_t.
+#include <limits> // For std::numeric_limits.
+#include <vector>
+
+#include "utils.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TSP_SIMD_DISPATCH 1
+#include <immintrin.h>
+#else
+#define TSP_SIMD_DISPATCH 0
+#endif
+
+namespace tsp
+{
+    enum class simd_isa { scalar, avx2, avx512 };
+
+    inline auto simd_isa_name(simd_isa isa) -> const char*
+    {
+        switch(isa)
+        {
+            case simd_isa::avx512: return "avx512";
+            case simd_isa::avx2:   return "avx2";
+            default:               return "scalar";
+        }
+    }
+
+    // The widest kernel this CPU can run.
+    inline auto supported_simd_isa() -> simd_isa
+    {
+#if TSP_SIMD_DISPATCH
+        if(__builtin_cpu_supports("avx512f")) return simd_isa::avx512;
+        if(__builtin_cpu_supports("avx2"))    return simd_isa::avx2;
+#endif
+        return simd_isa::scalar;
+    }
+
+    // The kernel used unless another one is asked for, see the top of the file.
+    inline auto default_simd_isa() -> simd_isa { return std::min(supported_simd_isa(), simd_isa::avx2); }
+
+    class tour_evaluator
+    {
+    public:
+        // Tours scored per call of score().
+        static constexpr auto lanes = std::size_t{16};
+
+        // Uses isa when the CPU supports it, or the widest one it does.
+        template<typename Mat>
+        explicit tour_evaluator(const Mat& mat, simd_isa isa = default_simd_isa());
+
+        auto isa() const -> simd_isa { return kernel; }
+        // Bytes per cost in the narrowed copy of the matrix.
+        auto cost_width() const -> std::size_t { return narrow.empty() ? 4 : 2; }
+
+        // costs[lane] = the sum of the edges of paths[0..length) of that lane,
+        // see the top of the file for the layout. All lanes are always scored.
+        auto score(const std::int32_t* paths, std::size_t length, std::size_t* costs) const -> void;
+
+        // Cost of a single closed tour (or any path), with the narrowed matrix.
+        template<typename Cicle>
+        auto cost(const Cicle& tour) const -> std::size_t
+        {
+            auto total = std::size_t{0};
+            for(std::size_t i = 1; i < tour.size(); ++i) { total += at(tour[i - 1], tour[i]); }
+            return total;
+        }
+
+    private:
+        // cost(from, to), the same as mat[{to, from}] of the original matrix.
+        auto at(std::size_t from, std::size_t to) const -> std::size_t
+        {
+            const auto i = (from << shift) + to;
+            return narrow.empty() ? wide[i] : narrow[i];
+        }
+
+        auto score_scalar(const std::int32_t* paths, std::size_t length, std::size_t* costs) const -> void;
+
+        std::size_t nodes;
+        unsigned shift; // log2 of the (padded) row length.
+        simd_isa kernel;
+        // Only one of them is filled, both have an extra padding element since
+        // the 16 bit gathers read 32 bits at a time.
+        std::vector<std::uint16_t, utils::aligned_allocator<std::uint16_t>> narrow;
+        std::vector<std::uint32_t, utils::aligned_allocator<std::uint32_t>> wide;
+    };
+}
+
+namespace tsp::detail
+{
+#if TSP_SIMD_DISPATCH
+    // The 16 bit costs are gathered as 32 bits (scale 2) and the upper half,
+    // which belongs to the next cost, is masked away.
+    template<typename T>
+    __attribute__((target("avx2")))
+    inline auto score_avx2(const T* base, unsigned shift, const std::int32_t* paths, std::size_t length, std::size_t* costs) -> void
+    {
+        constexpr auto scale = static_cast<int>(sizeof(T));
+        const auto mask  = _mm256_set1_epi32(sizeof(T) == 2 ? 0xFFFF : -1);
+        const auto table = reinterpret_cast<const int*>(base);
+        const auto count = _mm256_set1_epi32(static_cast<int>(shift));
+
+        // The 16 lanes are two vectors of 8.
+        auto sum_lo = _mm256_setzero_si256();
+        auto sum_hi = _mm256_setzero_si256();
+        auto prev_lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(paths));
+        auto prev_hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(paths + 8));
+        for(std::size_t pos = 1; pos < length; ++pos)
+        {
+            const auto next_lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(paths + pos * 16));
+            const auto next_hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(paths + pos * 16 + 8));
+            const auto idx_lo  = _mm256_add_epi32(_mm256_sllv_epi32(prev_lo, count), next_lo);
+            const auto idx_hi  = _mm256_add_epi32(_mm256_sllv_epi32(prev_hi, count), next_hi);
+            sum_lo = _mm256_add_epi32(sum_lo, _mm256_and_si256(_mm256_i32gather_epi32(table, idx_lo, scale), mask));
+            sum_hi = _mm256_add_epi32(sum_hi, _mm256_and_si256(_mm256_i32gather_epi32(table, idx_hi, scale), mask));
+            prev_lo = next_lo;
+            prev_hi = next_hi;
+        }
+        const auto out = reinterpret_cast<__m256i*>(costs);
+        _mm256_storeu_si256(out + 0, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(sum_lo)));
+        _mm256_storeu_si256(out + 1, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(sum_lo, 1)));
+        _mm256_storeu_si256(out + 2, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(sum_hi)));
+        _mm256_storeu_si256(out + 3, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(sum_hi, 1)));
+    }
+
+    // GCC's own AVX-512 intrinsics trip -Wuninitialized when inlined here.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+    template<typename T>
+    __attribute__((target("avx512f")))
+    inline auto score_avx512(const T* base, unsigned shift, const std::int32_t* paths, std::size_t length, std::size_t* costs) -> void
+    {
+        constexpr auto scale = static_cast<int>(sizeof(T));
+        const auto mask  = _mm512_set1_epi32(sizeof(T) == 2 ? 0xFFFF : -1);
+        const auto table = static_cast<const void*>(base);
+        const auto count = _mm512_set1_epi32(static_cast<int>(shift));
+
+        auto sum  = _mm512_setzero_si512();
+        auto prev = _mm512_loadu_si512(paths);
+        for(std::size_t pos = 1; pos < length; ++pos)
+        {
+            const auto next = _mm512_loadu_si512(paths + pos * 16);
+            const auto idx  = _mm512_add_epi32(_mm512_sllv_epi32(prev, count), next);
+            sum  = _mm512_add_epi32(sum, _mm512_and_si512(_mm512_i32gather_epi32(idx, table, scale), mask));
+            prev = next;
+        }
+        _mm512_storeu_si512(costs,     _mm512_cvtepu32_epi64(_mm512_castsi512_si256(sum)));
+        _mm512_storeu_si512(costs + 8, _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(sum, 1)));
+    }
+#pragma GCC diagnostic pop
+#endif
+}
+
+template<typename Mat>
+inline tsp::tour_evaluator::tour_evaluator(const Mat& mat, simd_isa isa)
+    : nodes{ utils::nodes(mat) }
+    , shift{ 0 }
+    , kernel{ std::min(supported_simd_isa(), isa) }
+{
+    while((std::size_t{1} << shift) < nodes) ++shift;
+    const auto cells = (nodes ? (nodes - 1) << shift : 0) + nodes + 1; // + 1 for the padding.
+
+    auto largest = std::size_t{0};
+    for(std::size_t y = 0; y < nodes; ++y) {
+        for(std::size_t x = 0; x < nodes; ++x) { largest = std::max<std::size_t>(largest, mat[{x, y}]); }
+    }
+
+    if(largest <= std::numeric_limits<std::uint16_t>::max())
+    {
+        narrow.assign(cells, 0);
+        for(std::size_t from = 0; from < nodes; ++from) {
+            for(std::size_t to = 0; to < nodes; ++to) { narrow[(from << shift) + to] = static_cast<std::uint16_t>(mat[{to, from}]); }
+        }
+    }
+    else
+    {
+        wide.assign(cells, 0);
+        for(std::size_t from = 0; from < nodes; ++from) {
+            for(std::size_t to = 0; to < nodes; ++to) { wide[(from << shift) + to] = static_cast<std::uint32_t>(mat[{to, from}]); }
+        }
+    }
+
+    // The vector kernels sum in 32 bits (and index with signed 32 bits).
+    const auto fits = largest <= std::numeric_limits<std::uint32_t>::max() / std::max<std::size_t>(1, nodes)
+                   && cells <= std::size_t{std::numeric_limits<std::int32_t>::max()};
+    if(!fits) kernel = simd_isa::scalar;
+}
+
+inline auto tsp::tour_evaluator::score(const std::int32_t* paths, std::size_t length, std::size_t* costs) const -> void
+{
+    if(length < 2) {
+        for(std::size_t lane = 0; lane < lanes; ++lane) { costs[lane] = 0; }
+        return;
+    }
+#if TSP_SIMD_DISPATCH
+    switch(kernel)
+    {
+        case simd_isa::avx512:
+            if(narrow.empty()) detail::score_avx512(wide.data(), shift, paths, length, costs);
+            else               detail::score_avx512(narrow.data(), shift, paths, length, costs);
+            return;
+        case simd_isa::avx2:
+            if(narrow.empty()) detail::score_avx2(wide.data(), shift, paths, length, costs);
+            else               detail::score_avx2(narrow.data(), shift, paths, length, costs);
+            return;
+        default: break;
+    }
+#endif
+    score_scalar(paths, length, costs);
+}
+
+inline auto tsp::tour_evaluator::score_scalar(const std::int32_t* paths, std::size_t length, std::size_t* costs) const -> void
+{
+    for(std::size_t lane = 0; lane < lanes; ++lane)
+    {
+        auto total = std::size_t{0};
+        for(std::size_t pos = 1; pos < length; ++pos) {
+            total += at(static_cast<std::size_t>(paths[(pos - 1) * lanes + lane]), static_cast<std::size_t>(paths[pos * lanes + lane]));
+        }
+        costs[lane] = total;
+    }
+}
@@ -0,0 +1,373 @@
+/// Contains a reader for TSPLIB instances (.tsp) and tours (.opt.tour).
+//
+// The file is mapped into memory with mmap and read in place: the header is
+// split into views of the mapping and the numbers are parsed straight out of
+// it with std::from_chars, so nothing is copied or allocated per token. That
+// matters for big EXPLICIT instances, which are mostly tens of megabytes of
+// integers.
+//
+// Supported inputs:
+// - EDGE_WEIGHT_TYPE: EXPLICIT with EDGE_WEIGHT_FORMAT FULL_MATRIX, UPPER_ROW,
+//   LOWER_ROW, UPPER_DIAG_ROW or LOWER_DIAG_ROW.
+// - EDGE_WEIGHT_TYPE: EUC_2D, ATT or GEO with a NODE_COORD_SECTION, the
+//   distances are computed with the TSPLIB rounding rules.
+//
+// Coordinate instances can be loaded without their matrix (load_options) and
+// solved through coordinates(instance), which computes the distances when
+// they are looked up, see distances.hpp.
+//
+// A tour from a .opt.tour file can be turned into a cycle like the ones the
+// solvers return and its cost is the known optimum, like the pN_answer
+// constants in data.hpp.
+//
+// Malformed or unsupported files throw tsp::tsplib::error.
+#pragma once
+
+#include <system_error> // For std::errc.
+#include <string_view>
+#include <charconv> // For std::from_chars.
+#include <stdexcept> // For std::runtime_error.
+#include <algorithm> // For std::rotate.
+#include <utility> // For std::exchange.
+#include <string>
+#include <vector>
+#include <array>
+#include <cmath> // For std::sqrt, std::cos and std::acos.
+
+#include <sys/mman.h> // For mmap.
+#include <sys/stat.h> // For fstat.
+#include <fcntl.h> // For open.
+#include <unistd.h> // For close.
+
+#include "utils.hpp"
+#include "tsp/distances.hpp"
+
+namespace tsp::tsplib
+{
+    struct error : std::runtime_error { using std::runtime_error::runtime_error; };
+
+    // How the distances of an instance are given.
+    enum class metric { explicit_weights, euc_2d, att, geo };
+
+    // The distance function of a coordinate metric.
+    struct metric_distance
+    {
+        metric kind;
+        auto operator()(const std::array<double, 2>& a, const std::array<double, 2>& b) const -> int;
+    };
+
+    struct instance
+    {
+        std::string name;
+        utils::matrix<int> mat;
+        // Only filled for coordinate based instances, in file order.
+        std::vector<std::array<double, 2>> coords;
+        metric weights = metric::explicit_weights;
+    };
+
+    struct load_options
+    {
+        // When false, coordinate instances leave mat empty (0 nodes), see coordinates().
+        bool matrix = true;
+    };
+
+    inline auto load(const std::string& path, const load_options& options = {}) -> instance;
+
+    // The costs of a coordinate instance computed from its points, caching
+    // cached_rows rows per thread. Throws tsplib::error for explicit ones.
+    inline auto coordinates(const instance& inst, std::size_t cached_rows = 4) -> coordinate_matrix<metric_distance>
+    {
+        if(inst.weights == metric::explicit_weights) { throw error{"tsplib: " + inst.name + " has no coordinates"}; }
+        return coordinate_matrix<metric_distance>{inst.coords, metric_distance{inst.weights}, cached_rows};
+    }
+
+    // The tour as a cycle starting and ending on node 0 (nodes are 0 based, unlike in the file).
+    inline auto load_tour(const std::string& path) -> std::vector<std::size_t>;
+
+    template<typename Mat, typename Cicle>
+    inline auto cost(const Mat& mat, const Cicle& cicle) -> std::size_t
+    {
+        auto total = std::size_t{0};
+        for(std::size_t i = 1; i < cicle.size(); ++i) { total += mat[{cicle[i], cicle[i - 1]}]; }
+        return total;
+    }
+}
+
+namespace tsp::tsplib::detail
+{
+    // Read only mapping of a whole file.
+    class mapped_file
+    {
+    public:
+        explicit mapped_file(const std::string& path)
+        {
+            const auto fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0) { throw error{"tsplib: can't open " + path}; }
+
+            struct stat st{};
+            if(::fstat(fd, &st) != 0) { ::close(fd); throw error{"tsplib: can't stat " + path}; }
+            length = static_cast<std::size_t>(st.st_size);
+
+            if(length)
+            {
+                auto* const addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(addr == MAP_FAILED) { ::close(fd); throw error{"tsplib: can't map " + path}; }
+                // We read it front to back exactly once.
+                ::madvise(addr, length, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(addr);
+            }
+            ::close(fd);
+        }
+
+        mapped_file(const mapped_file&) = delete;
+        auto operator=(const mapped_file&) -> mapped_file& = delete;
+        mapped_file(mapped_file&& other) noexcept
+            : data{ std::exchange(other.data, nullptr) }
+            , length{ std::exchange(other.length, 0) }
+        {}
+
+        ~mapped_file() { if(data) { ::munmap(const_cast<char*>(data), length); } }
+
+        auto view() const -> std::string_view { return {data, length}; }
+
+    private:
+        const char* data = nullptr;
+        std::size_t length = 0;
+    };
+
+    // Walks a view of the file without copying it.
+    class tokenizer
+    {
+    public:
+        explicit tokenizer(std::string_view text) : cur{ text.data() }, end{ text.data() + text.size() } {}
+
+        auto at_end() -> bool { skip_space(); return cur == end; }
+
+        // Up to (and skipping) the next newline, without surrounding whitespace.
+        auto line() -> std::string_view
+        {
+            skip_blank();
+            const auto* const begin = cur;
+            while(cur != end && *cur != '\n') ++cur;
+            auto result = trim({begin, static_cast<std::size_t>(cur - begin)});
+            if(cur != end) ++cur;
+            return result;
+        }
+
+        template<typename N>
+        auto number() -> N
+        {
+            skip_space();
+            auto value = N{};
+            // from_chars doesn't take a leading '+'.
+            if(cur != end && *cur == '+') ++cur;
+            const auto [ptr, ec] = std::from_chars(cur, end, value);
+            if(ec != std::errc{}) { throw error{"tsplib: expected a number"}; }
+            cur = ptr;
+            return value;
+        }
+
+        static auto trim(std::string_view s) -> std::string_view
+        {
+            while(!s.empty() && is_space(s.front())) s.remove_prefix(1);
+            while(!s.empty() && is_space(s.back()))  s.remove_suffix(1);
+            return s;
+        }
+
+    private:
+        static constexpr auto is_space(char c) -> bool { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+        auto skip_space() -> void { while(cur != end && is_space(*cur)) ++cur; }
+        auto skip_blank() -> void { while(cur != end && (*cur == ' ' || *cur == '\t' || *cur == '\r')) ++cur; }
+
+        const char* cur;
+        const char* end;
+    };
+
+    // The "KEY : VALUE" lines before the data, stops after the first section keyword.
+    struct header
+    {
+        std::string_view name;
+        std::string_view type;
+        std::string_view edge_weight_type;
+        std::string_view edge_weight_format;
+        std::size_t dimension = 0;
+        std::string_view section;
+    };
+
+    inline auto read_header(tokenizer& tokens) -> header
+    {
+        auto h = header{};
+        while(!tokens.at_end())
+        {
+            const auto line  = tokens.line();
+            const auto colon = line.find(':');
+            const auto key   = tokenizer::trim(line.substr(0, colon));
+            const auto value = colon == std::string_view::npos ? std::string_view{} : tokenizer::trim(line.substr(colon + 1));
+
+            if     (key == "NAME")               { h.name = value; }
+            else if(key == "TYPE")               { h.type = value; }
+            else if(key == "EDGE_WEIGHT_TYPE")   { h.edge_weight_type = value; }
+            else if(key == "EDGE_WEIGHT_FORMAT") { h.edge_weight_format = value; }
+            else if(key == "DIMENSION")
+            {
+                const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), h.dimension);
+                if(ec != std::errc{}) { throw error{"tsplib: bad DIMENSION"}; }
+            }
+            else if(key.size() > 8 && key.substr(key.size() - 8) == "_SECTION") { h.section = key; return h; }
+            else if(key == "EOF") { break; }
+            // Everything else (COMMENT, CAPACITY, ...) is ignored.
+        }
+        return h;
+    }
+
+    inline auto nint(double x) -> int { return static_cast<int>(x + 0.5); }
+
+    // From the TSPLIB documentation (TSPLIB95, section 2).
+    inline auto euc_2d(const std::array<double, 2>& a, const std::array<double, 2>& b) -> int
+    {
+        const auto dx = a[0] - b[0];
+        const auto dy = a[1] - b[1];
+        return nint(std::sqrt(dx * dx + dy * dy));
+    }
+
+    inline auto att(const std::array<double, 2>& a, const std::array<double, 2>& b) -> int
+    {
+        const auto dx = a[0] - b[0];
+        const auto dy = a[1] - b[1];
+        const auto r  = std::sqrt((dx * dx + dy * dy) / 10.0);
+        const auto t  = nint(r);
+        return t < r ? t + 1 : t;
+    }
+
+    // Latitude/longitude in radians, coordinates are DDD.MM (degrees and minutes).
+    inline auto geo_radians(double x) -> double
+    {
+        constexpr auto pi = 3.141592;
+        const auto deg = static_cast<int>(x);
+        const auto min = x - deg;
+        return pi * (deg + 5.0 * min / 3.0) / 180.0;
+    }
+
+    inline auto geo(const std::array<double, 2>& a, const std::array<double, 2>& b) -> int
+    {
+        constexpr auto rrr = 6378.388;
+        const auto q1 = std::cos(geo_radians(a[1]) - geo_radians(b[1]));
+        const auto q2 = std::cos(geo_radians(a[0]) - geo_radians(b[0]));
+        const auto q3 = std::cos(geo_radians(a[0]) + geo_radians(b[0]));
+        return static_cast<int>(rrr * std::acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) + 1.0);
+    }
+
+    inline auto read_explicit(tokenizer& tokens, const header& h, utils::matrix<int>& mat) -> void
+    {
+        const auto n   = h.dimension;
+        const auto set = [&](std::size_t i, std::size_t j, int w) { mat[{j, i}] = w; mat[{i, j}] = w; };
+        const auto fmt = h.edge_weight_format;
+
+        if(fmt == "FULL_MATRIX")
+        {
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                auto* const row = mat.row(i);
+                for(std::size_t j = 0; j < n; ++j) { row[j] = tokens.number<int>(); }
+            }
+        }
+        else if(fmt == "UPPER_ROW")      { for(std::size_t i = 0; i < n; ++i) for(auto j = i + 1; j < n; ++j) set(i, j, tokens.number<int>()); }
+        else if(fmt == "UPPER_DIAG_ROW") { for(std::size_t i = 0; i < n; ++i) for(auto j = i;     j < n; ++j) set(i, j, tokens.number<int>()); }
+        else if(fmt == "LOWER_ROW")      { for(std::size_t i = 0; i < n; ++i) for(std::size_t j = 0; j < i;  ++j) set(i, j, tokens.number<int>()); }
+        else if(fmt == "LOWER_DIAG_ROW") { for(std::size_t i = 0; i < n; ++i) for(std::size_t j = 0; j <= i; ++j) set(i, j, tokens.number<int>()); }
+        else { throw error{"tsplib: unsupported EDGE_WEIGHT_FORMAT " + std::string{fmt}}; }
+    }
+
+    inline auto parse_metric(std::string_view edge_weight_type) -> metric
+    {
+        if(edge_weight_type == "EUC_2D") return metric::euc_2d;
+        if(edge_weight_type == "ATT")    return metric::att;
+        if(edge_weight_type == "GEO")    return metric::geo;
+        throw error{"tsplib: unsupported EDGE_WEIGHT_TYPE " + std::string{edge_weight_type}};
+    }
+
+    template<typename Distance>
+    inline auto fill_from_coords(const std::vector<std::array<double, 2>>& coords, utils::matrix<int>& mat, Distance&& distance) -> void
+    {
+        for(std::size_t i = 0; i < coords.size(); ++i)
+        {
+            mat[{i, i}] = 0;
+            for(auto j = i + 1; j < coords.size(); ++j)
+            {
+                const auto d = distance(coords[i], coords[j]);
+                mat[{j, i}] = d;
+                mat[{i, j}] = d;
+            }
+        }
+    }
+}
+
+inline auto tsp::tsplib::metric_distance::operator()(const std::array<double, 2>& a, const std::array<double, 2>& b) const -> int
+{
+    switch(kind)
+    {
+        case metric::euc_2d: return detail::euc_2d(a, b);
+        case metric::att:    return detail::att(a, b);
+        case metric::geo:    return detail::geo(a, b);
+        default:             throw error{"tsplib: explicit weights have no distance function"};
+    }
+}
+
+inline auto tsp::tsplib::load(const std::string& path, const load_options& options) -> instance
+{
+    const auto file = detail::mapped_file{path};
+    auto tokens = detail::tokenizer{file.view()};
+    const auto h = detail::read_header(tokens);
+
+    if(h.type != "TSP" && h.type != "ATSP") { throw error{"tsplib: unsupported TYPE " + std::string{h.type}}; }
+    if(!h.dimension) { throw error{"tsplib: missing DIMENSION"}; }
+
+    if(h.edge_weight_type == "EXPLICIT")
+    {
+        if(h.section != "EDGE_WEIGHT_SECTION") { throw error{"tsplib: missing EDGE_WEIGHT_SECTION"}; }
+        auto result = instance{ std::string{h.name}, utils::matrix<int>{h.dimension}, {} };
+        detail::read_explicit(tokens, h, result.mat);
+        return result;
+    }
+
+    const auto weights = detail::parse_metric(h.edge_weight_type);
+    auto result = instance{ std::string{h.name}, utils::matrix<int>{options.matrix ? h.dimension : 0}, {}, weights };
+    if(h.section != "NODE_COORD_SECTION") { throw error{"tsplib: missing NODE_COORD_SECTION"}; }
+    result.coords.resize(h.dimension);
+    for(std::size_t i = 0; i < h.dimension; ++i)
+    {
+        const auto id = tokens.number<std::size_t>();
+        if(id < 1 || id > h.dimension) { throw error{"tsplib: node id out of range"}; }
+        result.coords[id - 1] = { tokens.number<double>(), tokens.number<double>() };
+    }
+
+    if(options.matrix) { detail::fill_from_coords(result.coords, result.mat, metric_distance{weights}); }
+    return result;
+}
+
+inline auto tsp::tsplib::load_tour(const std::string& path) -> std::vector<std::size_t>
+{
+    const auto file = detail::mapped_file{path};
+    auto tokens = detail::tokenizer{file.view()};
+    const auto h = detail::read_header(tokens);
+    if(h.section != "TOUR_SECTION") { throw error{"tsplib: missing TOUR_SECTION"}; }
+
+    auto tour = std::vector<std::size_t>{};
+    tour.reserve(h.dimension + 1);
+    while(!tokens.at_end())
+    {
+        const auto node = tokens.number<long long>();
+        if(node == -1) break;
+        if(node < 1) { throw error{"tsplib: bad node in TOUR_SECTION"}; }
+        tour.push_back(static_cast<std::size_t>(node - 1));
+    }
+    if(tour.empty()) { throw error{"tsplib: empty tour"}; }
+
+    // Start on node 0 and come back to it, like the solvers do.
+    const auto zero = std::find(tour.begin(), tour.end(), std::size_t{0});
+    if(zero == tour.end()) { throw error{"tsplib: tour doesn't visit node 1"}; }
+    std::rotate(tour.begin(), zero, tour.end());
+    tour.push_back(0);
+    return tour;
+}
@@ -0,0 +1,176 @@
+/// Contains a two-level doubly linked list tour, for 2-opt moves in O(sqrt(n)).
+//
+// Reversing part of an array tour costs as much as the part being reversed,
+// up to n / 2. Here the tour is cut into about sqrt(n) segments, each one a
+// range of a fixed array of nodes plus a reversed bit:
+//
+//     order    = {4, 1, 7 | 0, 2, 6 | 5, 3}
+//     segments = {[0, 2], [3, 5] reversed, [6, 7]}
+//     sequence = {0, 2, 1}                       tour: 4 1 7 5 3 6 2 0
+//
+// To reverse a path we first split the segments at both of its ends, so the
+// path is made of whole segments, and then reverse the order of those segments
+// in the sequence and flip their bits. Neither step touches more than about
+// sqrt(n) things, and nodes never move in the array.
+//
+// Every split adds a segment, so once there are too many of them the whole
+// thing is rebuilt from the current tour, which is O(n) but rare.
+#pragma once
+
+#include <algorithm> // For std::swap and std::max.
+#include <cstddef> // For std::size_t.
+#include <cmath> // For std::sqrt.
+#include <vector>
+
+namespace tsp
+{
+    class two_level_tour
+    {
+    public:
+        // cicle starts and ends on the same node, like the solvers return it.
+        template<typename Cicle>
+        explicit two_level_tour(const Cicle& cicle)
+            : order(cicle.begin(), cicle.end() - 1)
+            , position(order.size())
+            , segment_of(order.size())
+            , group{ std::max<std::size_t>(1, static_cast<std::size_t>(std::sqrt(static_cast<double>(order.size())))) }
+        {
+            for(std::size_t i = 0; i < order.size(); ++i) { position[order[i]] = i; }
+            rebuild();
+        }
+
+        auto size() const -> std::size_t { return order.size(); }
+
+        auto next(std::size_t node) const -> std::size_t
+        {
+            const auto& s = segments[segment_of[node]];
+            const auto i = position[node];
+            if(!s.reversed && i != s.hi) return order[i + 1];
+            if( s.reversed && i != s.lo) return order[i - 1];
+            return first(sequence[s.rank + 1 == sequence.size() ? 0 : s.rank + 1]);
+        }
+
+        auto prev(std::size_t node) const -> std::size_t
+        {
+            const auto& s = segments[segment_of[node]];
+            const auto i = position[node];
+            if(!s.reversed && i != s.lo) return order[i - 1];
+            if( s.reversed && i != s.hi) return order[i + 1];
+            return last(sequence[s.rank == 0 ? sequence.size() - 1 : s.rank - 1]);
+        }
+
+        // Removes edges (a, b) and (c, d) and adds (a, c) and (b, d). b must
+        // follow a and d follow c, in either direction (both the same one).
+        auto two_opt_move(std::size_t a, std::size_t b, std::size_t c, std::size_t d) -> void
+        {
+            if(next(a) == b) reverse_path(b, c);
+            else             reverse_path(a, d);
+        }
+
+        // Writes the tour back starting (and ending) on node 0.
+        template<typename Cicle>
+        auto write(Cicle& cicle) const -> void
+        {
+            auto node = std::size_t{0};
+            for(std::size_t i = 0; i < order.size(); ++i, node = next(node)) { cicle[i] = node; }
+            cicle[order.size()] = 0;
+        }
+
+    private:
+        struct segment
+        {
+            std::size_t lo, hi; // Inclusive range of order.
+            bool reversed;
+            std::size_t rank;   // Index in sequence.
+        };
+
+        auto first(std::size_t id) const -> std::size_t { const auto& s = segments[id]; return order[s.reversed ? s.hi : s.lo]; }
+        auto last(std::size_t id)  const -> std::size_t { const auto& s = segments[id]; return order[s.reversed ? s.lo : s.hi]; }
+
+        // Splits the segment of node so that it becomes the first of one.
+        // The smaller half becomes the new segment, so it is the one relabeled.
+        auto split_before(std::size_t node) -> void
+        {
+            const auto id = segment_of[node];
+            if(first(id) == node) return;
+
+            const auto s = segments[id];
+            const auto i = position[node];
+            // In tour order the segment is head then tail, node being the first of tail.
+            auto head = s;
+            auto tail = s;
+            if(!s.reversed) { head.hi = i - 1; tail.lo = i; }
+            else            { head.lo = i + 1; tail.hi = i; }
+
+            const auto move_tail = tail.hi - tail.lo <= head.hi - head.lo;
+            const auto new_id = segments.size();
+            segments[id] = move_tail ? head : tail;
+            segments.push_back(move_tail ? tail : head);
+            for(auto j = segments[new_id].lo; j <= segments[new_id].hi; ++j) { segment_of[order[j]] = new_id; }
+
+            const auto at = move_tail ? s.rank + 1 : s.rank;
+            sequence.insert(sequence.begin() + static_cast<std::ptrdiff_t>(at), new_id);
+            for(auto r = at; r < sequence.size(); ++r) { segments[sequence[r]].rank = r; }
+        }
+
+        // Reverses the path from -> ... -> to (following next). Reversing the
+        // rest of the cycle instead gives the same tour, so we flip the side
+        // with the fewest segments.
+        auto reverse_path(std::size_t from, std::size_t to) -> void
+        {
+            const auto after = next(to);
+            if(from == to || after == from) return;
+            split_before(from);
+            split_before(after);
+
+            const auto m = sequence.size();
+            auto r = segments[segment_of[from]].rank;
+            auto count = (segments[segment_of[to]].rank + m - r) % m + 1;
+            if(2 * count > m) {
+                r = segments[segment_of[after]].rank;
+                count = m - count;
+            }
+
+            for(std::size_t k = 0; k < count / 2; ++k) { std::swap(sequence[(r + k) % m], sequence[(r + count - 1 - k) % m]); }
+            for(std::size_t k = 0; k < count; ++k)
+            {
+                auto& s = segments[sequence[(r + k) % m]];
+                s.reversed = !s.reversed;
+                s.rank = (r + k) % m;
+            }
+
+            if(sequence.size() > 2 * (order.size() / group + 1)) rebuild();
+        }
+
+        // Lays the current tour out again, in order and in segments of group nodes.
+        auto rebuild() -> void
+        {
+            if(!segments.empty())
+            {
+                auto tour = std::vector<std::size_t>{};
+                tour.reserve(order.size());
+                auto node = order[0];
+                for(std::size_t i = 0; i < order.size(); ++i, node = next(node)) { tour.push_back(node); }
+                order = std::move(tour);
+                for(std::size_t i = 0; i < order.size(); ++i) { position[order[i]] = i; }
+            }
+
+            segments.clear();
+            sequence.clear();
+            for(std::size_t lo = 0; lo < order.size(); lo += group)
+            {
+                const auto hi = std::min(lo + group, order.size()) - 1;
+                for(auto i = lo; i <= hi; ++i) { segment_of[order[i]] = segments.size(); }
+                sequence.push_back(segments.size());
+                segments.push_back({lo, hi, false, segments.size()});
+            }
+        }
+
+        std::vector<std::size_t> order;      // Nodes, each segment is a range of it.
+        std::vector<std::size_t> position;   // Index of each node in order.
+        std::vector<std::size_t> segment_of; // Segment of each node.
+        std::vector<segment> segments;
+        std::vector<std::size_t> sequence;   // Segments in tour order.
+        std::size_t group;                   // Size of the segments after a rebuild.
+    };
+}
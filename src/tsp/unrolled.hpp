@@ -0,0 +1,203 @@
+/// Contains brute force kernels unrolled at compile time for small fixed instances.
+//
+// For a bidimensional_access the amount of nodes is known at compile time, and
+// for the small ones (up to unrolled_max_nodes) we let the compiler generate
+// the whole search instead of stepping permutations at runtime.
+//
+// The permutations are walked as a depth first search over the nodes still
+// left (a bitmask), in increasing order, so they come out in the same
+// lexicographic order as std::next_permutation. The depth is a template
+// parameter, so every level is its own function the compiler can inline into
+// the one above, and a path that is already too expensive prunes the whole
+// subtree below it.
+//
+// The last few levels aren't searched at all: with R nodes left the R! orders
+// of them come from a table made at compile time, and the cost of every order
+// is written out in full (R + 1 lookups each, shared parts get folded
+// together by the compiler):
+//
+//     left = {a, b, c}:  last -> a -> b -> c -> 0
+//                        last -> a -> c -> b -> 0
+//                        ...
+//                        last -> c -> b -> a -> 0
+//
+// The costs are copied into a small table, narrowed to 16 bits when they fit
+// (p1 is 11 * 11 * 2 bytes, a handful of cache lines), with from as the row so
+// every lookup of a level reads the same row.
+//
+// Symmetric matrices skip the cycles that are tried backwards like in
+// seq_brute_force: only paths whose last node is bigger than the second one
+// are kept, so a prefix is cut as soon as no node left is bigger than path[1].
+#pragma once
+
+#include <algorithm> // For std::next_permutation.
+#include <optional>
+#include <cstdint> // For the fixed width integers.
+#include <cstddef> // For std::size_t.
+#include <utility> // For std::index_sequence.
+#include <limits> // For std::numeric_limits.
+#include <array>
+#include <bit> // For std::countr_zero.
+
+#include "utils.hpp"
+#include "tsp/result.hpp"
+#include "tsp/instrument.hpp"
+
+namespace tsp
+{
+    // Largest instance the kernels are generated for, 11! orders is about as much as we want to unroll the search over.
+    constexpr auto unrolled_max_nodes = std::size_t{12};
+
+    template<typename Mat>
+    constexpr auto has_unrolled_v = utils::fixed_nodes_v<Mat> >= 3 && utils::fixed_nodes_v<Mat> <= unrolled_max_nodes;
+
+    // Same answer as seq_brute_force, only for matrices with has_unrolled_v.
+    template<typename Mat>
+    inline auto unrolled_brute_force(const Mat& mat, const std::optional<int> fix1 = {}) -> result<Mat>;
+}
+
+namespace tsp::detail
+{
+    constexpr auto factorial(std::size_t n) -> std::size_t { return n <= 1 ? 1 : n * factorial(n - 1); }
+
+    // Every order of R elements, in lexicographic order.
+    template<std::size_t R>
+    constexpr auto lexicographic_orders() -> std::array<std::array<std::uint8_t, R>, factorial(R)>
+    {
+        auto orders = std::array<std::array<std::uint8_t, R>, factorial(R)>{};
+        auto order  = std::array<std::uint8_t, R>{};
+        for(std::size_t i = 0; i < R; ++i) { order[i] = static_cast<std::uint8_t>(i); }
+        for(auto& o : orders) {
+            o = order;
+            std::next_permutation(order.begin(), order.end());
+        }
+        return orders;
+    }
+
+    template<std::size_t N, typename T>
+    struct unrolled_search
+    {
+        // Levels with this many nodes left or less are written out in full.
+        static constexpr auto tail_nodes = std::size_t{3};
+
+        std::array<T, N * N> d{}; // d[from * N + to] = cost(from, to).
+        std::array<std::uint8_t, N + 1> path{};
+        std::array<std::uint8_t, N + 1> best_path{};
+        std::size_t best = std::numeric_limits<std::size_t>::max();
+        bool one_way = false; // Only search one direction of every cycle.
+        instrument::recorder stats{"unrolled_brute_force"};
+
+        template<typename Mat>
+        explicit unrolled_search(const Mat& mat)
+        {
+            for(std::size_t from = 0; from < N; ++from) {
+                for(std::size_t to = 0; to < N; ++to) { d[from * N + to] = static_cast<T>(mat[{to, from}]); }
+            }
+        }
+
+        // path[0..Depth) is set and left has the nodes not in it.
+        template<std::size_t Depth>
+        auto search(std::uint32_t left, std::size_t cost) -> void
+        {
+            constexpr auto remaining = N - Depth;
+            if constexpr(Depth >= 2) {
+                if(one_way && (left >> (path[1] + 1)) == 0) { stats.add(0, instrument::prunes); return; }
+            }
+            if constexpr(remaining <= tail_nodes) { tail<Depth>(left, cost, std::make_index_sequence<factorial(remaining)>{}); }
+            else
+            {
+                const auto* const row = d.data() + path[Depth - 1] * N;
+                for(auto m = left; m; m &= m - 1)
+                {
+                    const auto next    = static_cast<std::size_t>(std::countr_zero(m));
+                    const auto through = cost + row[next];
+                    if(through >= best) { stats.add(0, instrument::prunes); continue; }
+                    path[Depth] = static_cast<std::uint8_t>(next);
+                    search<Depth + 1>(left & ~(std::uint32_t{1} << next), through);
+                }
+            }
+        }
+
+        template<std::size_t Depth, std::size_t... Order>
+        auto tail(std::uint32_t left, std::size_t cost, std::index_sequence<Order...>) -> void
+        {
+            constexpr auto remaining = N - Depth;
+            constexpr auto orders    = lexicographic_orders<remaining>();
+
+            // The nodes left, in increasing order.
+            auto nodes = std::array<std::size_t, remaining + 1>{};
+            for(std::size_t i = 0; i < remaining; ++i, left &= left - 1) { nodes[i] = static_cast<std::size_t>(std::countr_zero(left)); }
+
+            const auto last = static_cast<std::size_t>(path[Depth - 1]);
+            const auto order_cost = [&]<std::size_t O>(std::integral_constant<std::size_t, O>) {
+                return [&]<std::size_t... I>(std::index_sequence<I...>) {
+                    return cost
+                         + d[last * N + nodes[orders[O][0]]]
+                         + (std::size_t{0} + ... + d[nodes[orders[O][I]] * N + nodes[orders[O][I + 1]]])
+                         + d[nodes[orders[O][remaining - 1]] * N];
+                }(std::make_index_sequence<remaining - 1>{});
+            };
+            auto costs = std::array<std::size_t, sizeof...(Order)>{ order_cost(std::integral_constant<std::size_t, Order>{})... };
+            if(one_way) {
+                constexpr auto max = std::numeric_limits<std::size_t>::max();
+                for(std::size_t o = 0; o < costs.size(); ++o) {
+                    auto second = std::size_t{path[1]};
+                    if constexpr(Depth < 2) { second = nodes[orders[o][1 - Depth]]; }
+                    if(second > nodes[orders[o][remaining - 1]]) costs[o] = max;
+                }
+            }
+            stats.add(0, instrument::permutations, sizeof...(Order));
+            stats.add(0, instrument::lookups, sizeof...(Order) * (remaining + 1));
+
+            // The first cheapest one, like the other solvers.
+            auto cheapest = std::size_t{0};
+            for(std::size_t o = 1; o < sizeof...(Order); ++o) { if(costs[o] < costs[cheapest]) cheapest = o; }
+            if(costs[cheapest] >= best) return;
+
+            best      = costs[cheapest];
+            best_path = path;
+            for(std::size_t i = 0; i < remaining; ++i) { best_path[Depth + i] = static_cast<std::uint8_t>(nodes[orders[cheapest][i]]); }
+        }
+    };
+
+    template<typename T, typename Mat>
+    inline auto run_unrolled(const Mat& mat, const std::optional<int> fix1) -> result<Mat>
+    {
+        constexpr auto N = utils::fixed_nodes_v<Mat>;
+        auto search = unrolled_search<N, T>{mat};
+        // The other direction of a cycle beginning with {0, fix1} doesn't begin with it.
+        search.one_way = !fix1 && utils::is_symmetric(mat);
+
+        const auto all = static_cast<std::uint32_t>((std::uint64_t{1} << N) - 1) & ~std::uint32_t{1};
+        if(fix1)
+        {
+            const auto second = static_cast<std::size_t>(*fix1);
+            search.path[1] = static_cast<std::uint8_t>(second);
+            search.template search<2>(all & ~(std::uint32_t{1} << second), search.d[second]);
+        }
+        else
+        {
+            search.template search<1>(all, 0);
+        }
+        search.stats.publish();
+
+        auto smallest_cicle = utils::make_node_array<std::size_t, 1>(mat);
+        for(std::size_t i = 0; i < N; ++i) { smallest_cicle[i] = search.best_path[i]; }
+        return {search.best, smallest_cicle};
+    }
+}
+
+template<typename Mat>
+inline auto tsp::unrolled_brute_force(const Mat& mat, const std::optional<int> fix1) -> result<Mat>
+{
+    static_assert(has_unrolled_v<Mat>, "unrolled_brute_force needs a bidimensional_access of 3 to unrolled_max_nodes nodes");
+    constexpr auto N = utils::fixed_nodes_v<Mat>;
+
+    auto largest = std::size_t{0};
+    for(std::size_t y = 0; y < N; ++y) {
+        for(std::size_t x = 0; x < N; ++x) { largest = std::max<std::size_t>(largest, mat[{x, y}]); }
+    }
+    if(largest <= std::numeric_limits<std::uint16_t>::max()) { return detail::run_unrolled<std::uint16_t>(mat, fix1); }
+    if(largest <= std::numeric_limits<std::uint32_t>::max()) { return detail::run_unrolled<std::uint32_t>(mat, fix1); }
+    return detail::run_unrolled<std::uint64_t>(mat, fix1);
+}
@@ -0,0 +1,178 @@
+/// Contains a small work-stealing scheduler for the parallel solvers.
+//
+// Every worker owns a deque of tasks. Workers take from the back of their own
+// deque (so they go depth first and stay on warm data) and, when it runs dry,
+// steal from the front of the others (where the oldest and usually biggest
+// tasks are).
+//
+// A task may push more tasks while running, that is how the solvers split big
+// prefixes into smaller ones: the worker that holds {0, 3} turns it into
+// {0, 3, 1}, {0, 3, 2}, {0, 3, 4}, ... and the idle workers steal them.
+//
+// The scheduler is done once every pushed task has finished, which is tracked
+// with a single counter that is only decremented after a task (and so all the
+// tasks it pushed) is over.
+//
+// Workers can optionally be pinned to a core each (worker i on core i), which
+// keeps scaling measurements from being skewed by the OS moving threads around.
+#pragma once
+
+#include <algorithm> // For std::max.
+#include <optional>
+#include <cstddef> // For std::size_t.
+#include <memory> // For std::unique_ptr.
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+#if defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+#include "utils.hpp"
+
+namespace tsp
+{
+    // Amount of workers to use when the caller doesn't care, one per hardware thread.
+    inline auto default_workers() -> std::size_t
+    {
+        return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    // Pins the calling thread to the core-th of the CPUs it is allowed to run
+    // on (wrapping around the amount of them, so it stays inside a taskset or
+    // cgroup) and puts its old affinity back when it goes out of scope. Does
+    // nothing when not given a core, or outside of Linux.
+    class pin_guard
+    {
+    public:
+        explicit pin_guard(std::optional<std::size_t> core)
+        {
+#if defined(__linux__)
+            if(!core) return;
+            if(pthread_getaffinity_np(pthread_self(), sizeof(previous), &previous) != 0) return;
+            const auto allowed = CPU_COUNT(&previous);
+            if(allowed == 0) return;
+
+            auto skip = static_cast<int>(*core % static_cast<std::size_t>(allowed));
+            auto cpu = 0;
+            for(; cpu < CPU_SETSIZE; ++cpu) {
+                if(CPU_ISSET(cpu, &previous) && skip-- == 0) break;
+            }
+            auto set = cpu_set_t{};
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pinned = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+            (void)core;
+#endif
+        }
+        ~pin_guard()
+        {
+#if defined(__linux__)
+            if(pinned) pthread_setaffinity_np(pthread_self(), sizeof(previous), &previous);
+#endif
+        }
+
+        pin_guard(const pin_guard&) = delete;
+        auto operator=(const pin_guard&) -> pin_guard& = delete;
+
+    private:
+#if defined(__linux__)
+        cpu_set_t previous{};
+        bool pinned = false;
+#endif
+    };
+
+    template<typename Task>
+    class work_stealing_deques
+    {
+    public:
+        explicit work_stealing_deques(std::size_t workers)
+            : queues{ std::make_unique<queue[]>(workers) }
+            , workers{ workers }
+        {}
+
+        auto size() const -> std::size_t { return workers; }
+
+        auto push(std::size_t worker, Task task) -> void
+        {
+            pending.fetch_add(1, std::memory_order_relaxed);
+            auto lock = std::scoped_lock{queues[worker].lock};
+            queues[worker].tasks.push_back(std::move(task));
+        }
+
+        // Our own newest task, or the oldest task of somebody else.
+        auto pop(std::size_t worker) -> std::optional<Task>
+        {
+            {
+                auto& own = queues[worker];
+                auto lock = std::scoped_lock{own.lock};
+                if(!own.tasks.empty()) {
+                    auto task = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                    return task;
+                }
+            }
+            for(std::size_t i = 1; i < workers; ++i)
+            {
+                auto& victim = queues[(worker + i) % workers];
+                auto lock = std::scoped_lock{victim.lock};
+                if(!victim.tasks.empty()) {
+                    auto task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    return task;
+                }
+            }
+            return {};
+        }
+
+        // Must be called once for each popped task, after it pushed all of its children.
+        auto finish() -> void { pending.fetch_sub(1, std::memory_order_acq_rel); }
+        auto done() const -> bool { return pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        struct alignas(utils::cache_line) queue
+        {
+            std::mutex lock;
+            std::deque<Task> tasks;
+        };
+
+        std::unique_ptr<queue[]> queues;
+        std::size_t workers;
+        alignas(utils::cache_line) std::atomic<std::size_t> pending{0};
+    };
+
+    // Runs work(task, worker, deques) for the root task and everything it pushes,
+    // on a pool of the given amount of threads. Returns once all of them are done.
+    template<typename Task, typename Work>
+    inline auto run_work_stealing(Task root, Work&& work, std::size_t threads = default_workers(), bool pin = false) -> void
+    {
+        threads = std::max<std::size_t>(1, threads);
+
+        auto deques = work_stealing_deques<Task>{threads};
+        deques.push(0, std::move(root));
+
+        const auto worker_loop = [&](std::size_t worker)
+        {
+            const auto pinned = pin_guard{pin ? std::optional{worker} : std::nullopt};
+            while(!deques.done())
+            {
+                if(auto task = deques.pop(worker)) {
+                    work(*task, worker, deques);
+                    deques.finish();
+                }
+                else { std::this_thread::yield(); }
+            }
+        };
+
+        auto pool = std::vector<std::thread>{};
+        pool.reserve(threads - 1);
+        for(std::size_t i = 1; i < threads; ++i) { pool.emplace_back(worker_loop, i); }
+        worker_loop(0);
+        for(auto& thread : pool) { thread.join(); }
+    }
+}
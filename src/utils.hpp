@@ -3,8 +3,21 @@
 
 #include <type_traits>
 #include <utility> // For std::forward.
+#include <cstddef> // For std::size_t.
+#include <limits> // For std::numeric_limits.
+#include <new> // For std::align_val_t.
+#include <cstdint> // For std::int32_t.
+#include <vector>
 #include <array>
 
+// argmin picks its AVX2 version at runtime, so it doesn't need -mavx2.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define UTILS_SIMD_DISPATCH 1
+#include <immintrin.h>
+#else
+#define UTILS_SIMD_DISPATCH 0
+#endif
+
 namespace utils
 {
     // Extract first type from a parameter pack.
@@ -37,9 +50,39 @@ namespace utils
       return sqrt_helper(x, 0, x / 2 + 1);
     }
 
+    // Size of a cache line, used to keep big tables from sharing lines with their neighbours.
+    constexpr auto cache_line = std::size_t{64};
+
+    // Minimal allocator that hands out Align-aligned storage, so a std::vector
+    // of it always begins at a cache line boundary.
+    template <typename T, std::size_t Align = cache_line>
+    struct aligned_allocator
+    {
+        using value_type = T;
+
+        template <typename U>
+        struct rebind { using other = aligned_allocator<U, Align>; };
+
+        constexpr aligned_allocator() noexcept = default;
+        template <typename U>
+        constexpr aligned_allocator(const aligned_allocator<U, Align>&) noexcept {}
+
+        auto allocate(std::size_t n) -> T*
+        {
+            if(n > std::numeric_limits<std::size_t>::max() / sizeof(T)) { throw std::bad_array_new_length{}; }
+            return static_cast<T*>( ::operator new(n * sizeof(T), std::align_val_t{Align}) );
+        }
+        auto deallocate(T* p, std::size_t) noexcept -> void { ::operator delete(p, std::align_val_t{Align}); }
+
+        template <typename U>
+        constexpr auto operator==(const aligned_allocator<U, Align>&) const noexcept { return true; }
+    };
+
     // Accesses a 1D array as if it was 2D, assuming X grows to the right and Y grows down.
     template <typename T, std::size_t Size>
     struct bidimensional_access{
+        using value_type = T;
+
         const std::array<T, Size>& original;
 
         struct span {
@@ -59,4 +102,164 @@ namespace utils
 
         constexpr auto operator[](span s) const -> const T& { return original[s.x + s.y * dims.x]; }
     };
+
+    // A runtime sized square matrix with the same interface as bidimensional_access.
+    //
+    // Each row is padded to a whole number of cache lines and the storage is
+    // cache line aligned, so every row starts on its own line.
+    template <typename T>
+    class matrix
+    {
+    public:
+        using value_type = T;
+
+        struct span {
+            std::size_t x;
+            std::size_t y;
+        } dims;
+
+        explicit matrix(std::size_t nodes)
+            : dims{ nodes, nodes }
+            , row_stride{ padded(nodes) }
+            , storage( row_stride * nodes, T{} )
+        {}
+
+        // Copies a (row-major, nodes * nodes) matrix.
+        template <typename It>
+        matrix(std::size_t nodes, It first)
+            : matrix(nodes)
+        {
+            for(std::size_t y = 0; y < nodes; ++y) {
+                for(std::size_t x = 0; x < nodes; ++x, ++first) { (*this)[{x, y}] = *first; }
+            }
+        }
+
+        template <std::size_t Size>
+        explicit matrix(const bidimensional_access<T, Size>& fixed)
+            : matrix(fixed.dims.x, fixed.original.begin())
+        {}
+
+        auto operator[](span s) const -> const T& { return storage[s.x + s.y * row_stride]; }
+        auto operator[](span s) -> T& { return storage[s.x + s.y * row_stride]; }
+
+        auto row(std::size_t y) const -> const T* { return storage.data() + y * row_stride; }
+        auto row(std::size_t y) -> T* { return storage.data() + y * row_stride; }
+        auto stride() const -> std::size_t { return row_stride; }
+
+    private:
+        static constexpr auto padded(std::size_t n) -> std::size_t
+        {
+            constexpr auto per_line = cache_line / sizeof(T) ? cache_line / sizeof(T) : 1;
+            return (n + per_line - 1) / per_line * per_line;
+        }
+
+        std::size_t row_stride;
+        std::vector<T, aligned_allocator<T>> storage;
+    };
+
+    // Amount of nodes of a matrix, known at compile time for bidimensional_access and 0 otherwise.
+    template <typename Mat>
+    struct fixed_nodes : std::integral_constant<std::size_t, 0> {};
+    template <typename T, std::size_t Size>
+    struct fixed_nodes<bidimensional_access<T, Size>> : std::integral_constant<std::size_t, ct_sqrt(Size)> {};
+    template <typename Mat>
+    constexpr auto fixed_nodes_v = fixed_nodes<std::remove_cv_t<std::remove_reference_t<Mat>>>::value;
+
+    // Amount of nodes of any matrix.
+    template <typename Mat>
+    constexpr auto nodes(const Mat& mat) -> std::size_t
+    {
+        if constexpr(fixed_nodes_v<Mat> != 0) { return fixed_nodes_v<Mat>; }
+        else                                  { return mat.dims.x; }
+    }
+
+    // Per node storage (plus Extra slots) for some matrix: a std::array when the
+    // amount of nodes is known at compile time and a std::vector otherwise.
+    template <typename U, typename Mat, std::size_t Extra = 0>
+    using node_array = std::conditional_t<
+        fixed_nodes_v<Mat> != 0,
+        std::array<U, fixed_nodes_v<Mat> + Extra>,
+        std::vector<U>
+    >;
+
+    template <typename U, std::size_t Extra = 0, typename Mat>
+    constexpr auto make_node_array(const Mat& mat, const U& value = U{}) -> node_array<U, Mat, Extra>
+    {
+        auto arr = node_array<U, Mat, Extra>{};
+        if constexpr(fixed_nodes_v<Mat> == 0) { arr.resize(nodes(mat) + Extra); }
+        for(auto& e : arr) { e = value; }
+        return arr;
+    }
+
+    // Whether going from a to b always costs the same as going from b to a.
+    template <typename Mat>
+    inline auto is_symmetric(const Mat& mat) -> bool
+    {
+        const auto n = nodes(mat);
+        for(std::size_t y = 0; y < n; ++y) {
+            for(std::size_t x = y + 1; x < n; ++x) { if(!(mat[{x, y}] == mat[{y, x}])) return false; }
+        }
+        return true;
+    }
+
+    // Index of the smallest of values[0, n), the first one on ties.
+    template <typename T>
+    inline auto argmin(const T* values, std::size_t n) -> std::size_t
+    {
+        auto best = std::size_t{0};
+        for(std::size_t i = 1; i < n; ++i) { if(values[i] < values[best]) best = i; }
+        return best;
+    }
+
+#if UTILS_SIMD_DISPATCH
+    namespace detail
+    {
+        // Eight lanes at a time, each lane remembers its smallest value and where
+        // it was, then the lanes are merged. Needs n >= 8.
+        __attribute__((target("avx2")))
+        inline auto argmin_avx2(const std::int32_t* values, std::size_t n) -> std::size_t
+        {
+            auto lane_min = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values));
+            auto lane_idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            auto idx      = lane_idx;
+            const auto step = _mm256_set1_epi32(8);
+
+            auto i = std::size_t{8};
+            for(; i + 8 <= n; i += 8)
+            {
+                idx = _mm256_add_epi32(idx, step);
+                const auto v    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+                const auto less = _mm256_cmpgt_epi32(lane_min, v);
+                lane_min = _mm256_min_epi32(lane_min, v);
+                lane_idx = _mm256_blendv_epi8(lane_idx, idx, less);
+            }
+
+            alignas(32) std::int32_t mins[8];
+            alignas(32) std::int32_t idxs[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(mins), lane_min);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(idxs), lane_idx);
+
+            auto best = static_cast<std::size_t>(idxs[0]);
+            for(auto lane = 1; lane < 8; ++lane)
+            {
+                const auto candidate = static_cast<std::size_t>(idxs[lane]);
+                if(mins[lane] < values[best] || (mins[lane] == values[best] && candidate < best)) best = candidate;
+            }
+            for(; i < n; ++i) { if(values[i] < values[best]) best = i; }
+            return best;
+        }
+    }
+
+    // The AVX2 version when this CPU has it (checked once, with CPUID).
+    template <>
+    inline auto argmin(const std::int32_t* values, std::size_t n) -> std::size_t
+    {
+        static const auto avx2 = __builtin_cpu_supports("avx2") != 0;
+        if(avx2 && n >= 16) return detail::argmin_avx2(values, n);
+
+        auto best = std::size_t{0};
+        for(std::size_t i = 1; i < n; ++i) { if(values[i] < values[best]) best = i; }
+        return best;
+    }
+#endif
 }